@@ -0,0 +1,144 @@
+#include "AdaptiveModel.h"
+#include <algorithm>
+#include <vector>
+
+void AdaptiveModel::reset() {
+    // The tree starts as a lone NYT leaf
+    nodes[ROOT] = Node{0, NO_NODE, NO_NODE, NO_NODE, NYT};
+    leaf.fill(NO_NODE);
+    leaf[NYT] = ROOT;
+}
+
+void AdaptiveModel::encode(unsigned char symbol, BitWriter& writer) {
+    bool known = leaf[symbol] != NO_NODE;
+    uint16_t node = known ? leaf[symbol] : leaf[NYT];
+
+    // The path is collected from the leaf up and written from the root down
+    unsigned char path[ROOT + 1];
+    int depth = 0;
+    for (; node != ROOT; node = nodes[node].parent)
+        path[depth++] = nodes[nodes[node].parent].right == node;
+    uint64_t bits = 0;
+    int length = 0;
+    while (depth > 0) {
+        bits = (bits << 1) | path[--depth];
+        if (++length == 32) {
+            writer.write(bits, length);
+            bits = 0;
+            length = 0;
+        }
+    }
+    writer.write(bits, length);
+    if (!known)
+        writer.write(symbol, 8);
+    update(symbol);
+}
+
+bool AdaptiveModel::decode(const unsigned char* data, size_t size, size_t& bitPos, unsigned char& symbol) {
+    const size_t bitCount = size * 8;
+    uint16_t node = ROOT;
+    while (nodes[node].left != NO_NODE) {
+        if (bitPos >= bitCount)
+            return false;
+        int bit = (data[bitPos >> 3] >> (7 - (bitPos & 7))) & 1;
+        ++bitPos;
+        node = bit ? nodes[node].right : nodes[node].left;
+    }
+    if (nodes[node].symbol == NYT) {
+        if (bitPos + 8 > bitCount)
+            return false;
+        unsigned value = 0;
+        for (int i = 0; i < 8; ++i, ++bitPos)
+            value = (value << 1) | ((data[bitPos >> 3] >> (7 - (bitPos & 7))) & 1);
+        symbol = static_cast<unsigned char>(value);
+    } else {
+        symbol = static_cast<unsigned char>(nodes[node].symbol);
+    }
+    update(symbol);
+    return true;
+}
+
+void AdaptiveModel::update(uint16_t symbol) {
+    uint16_t node = leaf[symbol];
+    if (node == NO_NODE) {
+        // Split the NYT leaf: it becomes the parent of a new NYT leaf and of the new symbol
+        uint16_t parent = leaf[NYT];
+        nodes[parent - 2] = Node{0, parent, NO_NODE, NO_NODE, NYT};
+        nodes[parent - 1] = Node{0, parent, NO_NODE, NO_NODE, symbol};
+        nodes[parent].left = parent - 2;
+        nodes[parent].right = parent - 1;
+        nodes[parent].symbol = NO_NODE;
+        leaf[NYT] = parent - 2;
+        leaf[symbol] = parent - 1;
+        node = parent - 1;
+    }
+
+    // Each node on the path first moves to the highest number of its weight class, then gains weight.
+    // Only the parent can share a node's weight (the sibling is then the weight-0 NYT leaf), and stays put.
+    while (node != NO_NODE) {
+        uint16_t leader = node;
+        while (leader < ROOT && nodes[leader + 1].weight == nodes[node].weight)
+            ++leader;
+        if (leader != node && leader != nodes[node].parent) {
+            swapNodes(node, leader);
+            node = leader;
+        }
+        ++nodes[node].weight;
+        node = nodes[node].parent;
+    }
+
+    if (nodes[ROOT].weight >= MAX_WEIGHT)
+        rescale();
+}
+
+void AdaptiveModel::swapNodes(uint16_t a, uint16_t b) {
+    // Subtrees trade places, each number keeps its parent link
+    swap(nodes[a].left, nodes[b].left);
+    swap(nodes[a].right, nodes[b].right);
+    swap(nodes[a].symbol, nodes[b].symbol);
+    for (uint16_t node : {a, b}) {
+        if (nodes[node].left != NO_NODE) {
+            nodes[nodes[node].left].parent = node;
+            nodes[nodes[node].right].parent = node;
+        } else {
+            leaf[nodes[node].symbol] = node;
+        }
+    }
+}
+
+void AdaptiveModel::rescale() {
+    // Halve the weights, so the model follows recent input and weights stay bounded, then rebuild
+    // the tree with two queues. Nodes leave the queues in non-decreasing weight order with siblings
+    // next to each other, so numbering them in that order restores the sibling property.
+    vector<Node> leaves;
+    for (uint16_t symbol = 0; symbol <= NYT; ++symbol) {
+        if (leaf[symbol] != NO_NODE)
+            leaves.push_back(Node{(nodes[leaf[symbol]].weight + 1) / 2, NO_NODE, NO_NODE, NO_NODE, symbol});
+    }
+    stable_sort(leaves.begin(), leaves.end(), [](const Node& a, const Node& b) { return a.weight < b.weight; });
+
+    vector<Node> internal;
+    internal.reserve(leaves.size());
+    size_t nextLeaf = 0, nextInternal = 0;
+    uint16_t number = static_cast<uint16_t>(ROOT + 2 - 2 * leaves.size());
+    auto take = [&]() {
+        bool fromLeaves = nextInternal == internal.size()
+                          || (nextLeaf < leaves.size() && leaves[nextLeaf].weight <= internal[nextInternal].weight);
+        Node node = fromLeaves ? leaves[nextLeaf++] : internal[nextInternal++];
+        node.parent = NO_NODE;
+        nodes[number] = node;
+        if (node.left != NO_NODE) {
+            nodes[node.left].parent = number;
+            nodes[node.right].parent = number;
+        } else {
+            leaf[node.symbol] = number;
+        }
+        return number++;
+    };
+    while (leaves.size() - nextLeaf + internal.size() - nextInternal > 1) {
+        uint16_t left = take();
+        uint16_t right = take();
+        internal.push_back(Node{nodes[left].weight + nodes[right].weight, NO_NODE, left, right, NO_NODE});
+    }
+    take();
+}
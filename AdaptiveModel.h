@@ -0,0 +1,40 @@
+#ifndef ADAPTIVE_MODEL_H
+#define ADAPTIVE_MODEL_H
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include "BitStream.h"
+using namespace std;
+
+// Adaptive Huffman tree (FGK), updated identically by encoder and decoder after every
+// symbol. A node's number is its index, and weights never decrease with the number
+// (sibling property). Symbols seen for the first time are sent as the code of the
+// not-yet-transmitted (NYT) leaf followed by the 8 raw bits of the symbol.
+class AdaptiveModel {
+public:
+    void reset();
+    void encode(unsigned char symbol, BitWriter& writer);
+    // Decodes the symbol at bitPos and advances it, false when the data ends first
+    bool decode(const unsigned char* data, size_t size, size_t& bitPos, unsigned char& symbol);
+
+private:
+    static constexpr uint16_t NYT = 256; // Symbol of the NYT leaf
+    static constexpr uint16_t NO_NODE = numeric_limits<uint16_t>::max();
+    static constexpr uint16_t ROOT = 512; // 257 leaves and 256 internal nodes, the root numbered highest
+    static constexpr uint32_t MAX_WEIGHT = 1 << 16; // Root weight at which all weights are halved
+
+    struct Node {
+        uint32_t weight;
+        uint16_t parent, left, right; // Node numbers, NO_NODE where absent
+        uint16_t symbol; // Symbol of a leaf, NO_NODE for internal nodes
+    };
+
+    array<Node, ROOT + 1> nodes; // Live nodes are numbered from the NYT leaf up to the root
+    array<uint16_t, NYT + 1> leaf; // Node of each symbol, NO_NODE until it is first seen
+
+    void update(uint16_t symbol);
+    void swapNodes(uint16_t a, uint16_t b);
+    void rescale();
+};
+#endif // ADAPTIVE_MODEL_H
@@ -0,0 +1,81 @@
+#ifndef BIT_STREAM_H
+#define BIT_STREAM_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+// Reads a bitstream most significant bit first through a 64-bit buffer
+struct BitReader {
+    const unsigned char* data;
+    size_t size;
+    size_t pos = 0; // Next byte to load
+    uint64_t buffer = 0; // Pending bits, left aligned
+    int count = 0; // Number of pending bits, negative once more bits were consumed than exist
+
+    BitReader(const unsigned char* data, size_t size) : data(data), size(size) {}
+    void refill();
+};
+
+// Packs variable-length codes into an output buffer through a 64-bit accumulator
+struct BitWriter {
+    vector<unsigned char>& out; // Output buffer
+    uint64_t buffer = 0; // Pending bits, left aligned
+    int count = 0; // Number of pending bits
+
+    explicit BitWriter(vector<unsigned char>& out) : out(out) {}
+    void write(uint64_t bits, int length);
+    void flush();
+};
+
+// Both are defined here so the coding loops of every unit can inline them
+
+inline void BitReader::refill() {
+    if (pos + 8 <= size) {
+        // Branch-free refill: load 8 bytes and keep the whole bytes that fit, the partial
+        // byte is loaded again at the same position next time
+        const unsigned char* p = data + pos;
+        uint64_t word = uint64_t(p[0]) << 56 | uint64_t(p[1]) << 48 | uint64_t(p[2]) << 40 | uint64_t(p[3]) << 32
+                        | uint64_t(p[4]) << 24 | uint64_t(p[5]) << 16 | uint64_t(p[6]) << 8 | uint64_t(p[7]);
+        buffer |= word >> count;
+        pos += (63 - count) >> 3;
+        count |= 56;
+        return;
+    }
+    while (count <= 56 && pos < size) {
+        buffer |= uint64_t(data[pos++]) << (56 - count);
+        count += 8;
+    }
+}
+
+inline void BitWriter::write(uint64_t bits, int length) {
+    if (length == 0)
+        return;
+    if (length > 32) {
+        write(bits >> 32, length - 32);
+        bits &= 0xFFFFFFFFu;
+        length = 32;
+    }
+    buffer |= bits << (64 - count - length);
+    count += length;
+    if (count >= 32) {
+        out.push_back(static_cast<unsigned char>(buffer >> 56));
+        out.push_back(static_cast<unsigned char>(buffer >> 48));
+        out.push_back(static_cast<unsigned char>(buffer >> 40));
+        out.push_back(static_cast<unsigned char>(buffer >> 32));
+        buffer <<= 32;
+        count -= 32;
+    }
+}
+
+inline void BitWriter::flush() {
+    // The last byte is padded with zero bits
+    while (count > 0) {
+        out.push_back(static_cast<unsigned char>(buffer >> 56));
+        buffer <<= 8;
+        count -= 8;
+    }
+    buffer = 0;
+    count = 0;
+}
+#endif // BIT_STREAM_H
@@ -0,0 +1,80 @@
+#include "ContextClustering.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+using namespace std;
+
+using Histogram = array<uint32_t, 256>;
+
+int clusterContexts(const vector<Histogram>& contextFreq, int clusterCount, array<uint8_t, 256>& clusterOf) {
+    // k-means over the contexts in use: each joins the table that codes its histogram in the fewest
+    // estimated bits. The busiest contexts seed the tables. Returns the number of non-empty tables.
+    vector<int> contexts;
+    vector<uint64_t> totals(256, 0);
+    vector<vector<pair<uint8_t, uint32_t>>> present(256); // Symbols occurring in each context
+    for (int context = 0; context < 256; ++context) {
+        for (int symbol = 0; symbol < 256; ++symbol) {
+            if (contextFreq[context][symbol] != 0) {
+                present[context].emplace_back(symbol, contextFreq[context][symbol]);
+                totals[context] += contextFreq[context][symbol];
+            }
+        }
+        if (totals[context] != 0)
+            contexts.push_back(context);
+    }
+    stable_sort(contexts.begin(), contexts.end(), [&](int a, int b) { return totals[a] > totals[b]; });
+    clusterOf.fill(0);
+    clusterCount = max(1, min<int>(clusterCount, contexts.size()));
+    for (int cluster = 0; cluster < clusterCount; ++cluster)
+        clusterOf[contexts[cluster]] = cluster;
+
+    vector<array<float, 256>> cost(clusterCount);
+    for (int iteration = 0; iteration < 4; ++iteration) {
+        // Estimated code length of every symbol under every table, the first pass sees only the seeds
+        vector<Histogram> clusterFreq(clusterCount, Histogram{});
+        size_t members = iteration == 0 ? clusterCount : contexts.size();
+        for (size_t i = 0; i < members; ++i) {
+            for (const auto& entry : present[contexts[i]])
+                clusterFreq[clusterOf[contexts[i]]][entry.first] += entry.second;
+        }
+        for (int cluster = 0; cluster < clusterCount; ++cluster) {
+            uint64_t total = 0;
+            for (uint32_t count : clusterFreq[cluster])
+                total += count;
+            for (int symbol = 0; symbol < 256; ++symbol)
+                cost[cluster][symbol] = log2(float(total) + 1) - log2(float(clusterFreq[cluster][symbol]) + 0.5f);
+        }
+
+        bool changed = false;
+        for (int context : contexts) {
+            int best = clusterOf[context];
+            float bestCost = numeric_limits<float>::max();
+            for (int cluster = 0; cluster < clusterCount; ++cluster) {
+                float bits = 0;
+                for (const auto& entry : present[context])
+                    bits += entry.second * cost[cluster][entry.first];
+                if (bits < bestCost) {
+                    bestCost = bits;
+                    best = cluster;
+                }
+            }
+            changed = changed || best != clusterOf[context];
+            clusterOf[context] = best;
+        }
+        if (!changed && iteration > 0)
+            break;
+    }
+
+    // Drop tables that lost all their contexts and number the rest densely
+    array<int, MAX_CONTEXT_CLUSTERS> renumber;
+    renumber.fill(-1);
+    int used = 0;
+    for (int context : contexts) {
+        if (renumber[clusterOf[context]] < 0)
+            renumber[clusterOf[context]] = used++;
+        clusterOf[context] = renumber[clusterOf[context]];
+    }
+    return max(used, 1);
+}
@@ -0,0 +1,13 @@
+#ifndef CONTEXT_CLUSTERING_H
+#define CONTEXT_CLUSTERING_H
+#include <array>
+#include <cstdint>
+#include <vector>
+
+constexpr int MAX_CONTEXT_CLUSTERS = 16; // Code tables of a context frame, table ids fit in a nibble
+
+// Groups the 256 order-1 contexts, given the byte histogram of each, into at most clusterCount
+// (up to MAX_CONTEXT_CLUSTERS) code tables. clusterOf receives the table of each context, unused
+// contexts get table 0. Returns the number of tables in use.
+int clusterContexts(const std::vector<std::array<uint32_t, 256>>& contextFreq, int clusterCount, std::array<uint8_t, 256>& clusterOf);
+#endif // CONTEXT_CLUSTERING_H
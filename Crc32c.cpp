@@ -0,0 +1,99 @@
+#include "Crc32c.h"
+#include <cstring>
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#endif
+
+namespace {
+
+const uint32_t POLYNOMIAL = 0x82F63B78; // Castagnoli polynomial, bit-reversed
+
+// Slice-by-8 tables: table[k][b] is the CRC of byte b followed by k zero bytes
+struct Crc32cTables {
+    uint32_t table[8][256];
+
+    Crc32cTables() {
+        for (uint32_t byte = 0; byte < 256; ++byte) {
+            uint32_t crc = byte;
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc >> 1) ^ (crc & 1 ? POLYNOMIAL : 0);
+            table[0][byte] = crc;
+        }
+        for (int k = 1; k < 8; ++k) {
+            for (int byte = 0; byte < 256; ++byte)
+                table[k][byte] = (table[k - 1][byte] >> 8) ^ table[0][table[k - 1][byte] & 0xFF];
+        }
+    }
+};
+
+uint32_t crc32cSoftware(uint32_t crc, const unsigned char* p, size_t size) {
+    static const Crc32cTables tables;
+    const auto& t = tables.table;
+    while (size >= 8) {
+        uint32_t low = crc ^ (p[0] | p[1] << 8 | p[2] << 16 | uint32_t(p[3]) << 24);
+        uint32_t high = p[4] | p[5] << 8 | p[6] << 16 | uint32_t(p[7]) << 24;
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24]
+              ^ t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0)
+        crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+#ifdef CRC32C_X86
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sse4.2")))
+#endif
+uint32_t crc32cHardware(uint32_t crc, const unsigned char* p, size_t size) {
+#if defined(__x86_64__) || defined(_M_X64)
+    uint64_t crc64 = crc;
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        size -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    while (size >= 4) {
+        uint32_t word;
+        memcpy(&word, p, 4);
+        crc = _mm_crc32_u32(crc, word);
+        p += 4;
+        size -= 4;
+    }
+    while (size-- > 0)
+        crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+
+bool hasSse42() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] >> 20) & 1;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#endif
+
+} // namespace
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+#ifdef CRC32C_X86
+    static const bool hardware = hasSse42();
+    if (hardware)
+        return ~crc32cHardware(~crc, p, size);
+#endif
+    return ~crc32cSoftware(~crc, p, size);
+}
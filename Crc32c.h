@@ -0,0 +1,9 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+#include <cstddef>
+#include <cstdint>
+
+// CRC32C (Castagnoli) of size bytes, continuing from crc, which is 0 for a new checksum.
+// Uses the SSE4.2 crc32 instruction when the CPU has it and slice-by-8 tables otherwise.
+uint32_t crc32c(uint32_t crc, const void* data, size_t size);
+#endif // CRC32C_H
@@ -0,0 +1,14 @@
+# Top-level project: the codec library and every front end linking against it
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    codec \
+    cli \
+    benchmark \
+    tests \
+    QT_implement
+
+cli.depends = codec
+benchmark.depends = codec
+tests.depends = codec
+QT_implement.depends = codec
@@ -1,210 +1,2031 @@
 #include "HuffmanCoding.h"
-void HuffmanCoding::swapMinHeapNode(MinHeapNode** a, MinHeapNode** b) {
-    MinHeapNode* t = *a;
-    *a = *b;
-    *b = t;
-}
+#include "Crc32c.h"
+#include "SuffixArray.h"
+#include "LzMatcher.h"
+#include "WordTokenizer.h"
+#include "ContextClustering.h"
+#include <new>
 
-void HuffmanCoding::minHeapify(MinHeap* minHeap, int idx) {
-    int smallest = idx;
-    int left = 2 * idx + 1;
-    int right = 2 * idx + 2;
+void HuffmanCoding::countSymbols(const unsigned char* data, size_t size, Histogram& freq) {
+    // Four interleaved sub-histograms keep runs of the same byte from serializing on one counter
+    uint32_t counts[4][256] = {{0}};
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        counts[0][word & 0xFF]++;
+        counts[1][(word >> 8) & 0xFF]++;
+        counts[2][(word >> 16) & 0xFF]++;
+        counts[3][(word >> 24) & 0xFF]++;
+        counts[0][(word >> 32) & 0xFF]++;
+        counts[1][(word >> 40) & 0xFF]++;
+        counts[2][(word >> 48) & 0xFF]++;
+        counts[3][word >> 56]++;
+    }
+    for (; i < size; ++i)
+        counts[0][data[i]]++;
+    for (int symbol = 0; symbol < 256; ++symbol)
+        freq[symbol] = counts[0][symbol] + counts[1][symbol] + counts[2][symbol] + counts[3][symbol];
+}
 
-    if (left < minHeap->array.size() && minHeap->array[left]->freq < minHeap->array[smallest]->freq)
-        smallest = left;
+template <class A>
+void HuffmanCoding::buildHuffmanTree(const uint32_t* freq, typename A::Tree& tree) {
+    using Symbol = typename A::SymbolType;
+    using Index = typename A::NodeIndex;
+    tree.nodes.clear();
 
-    if (right < minHeap->array.size() && minHeap->array[right]->freq < minHeap->array[smallest]->freq)
-        smallest = right;
+    // Leaves sorted by frequency form the first queue, ties broken by symbol for a deterministic tree
+    vector<pair<unsigned, Symbol>> leaves;
+    for (size_t symbol = 0; symbol < A::SIZE; ++symbol) {
+        if (freq[symbol] != 0)
+            leaves.emplace_back(freq[symbol], static_cast<Symbol>(symbol));
+    }
+    sort(leaves.begin(), leaves.end());
+    tree.nodes.reserve(2 * leaves.size());
+    for (const auto& leaf : leaves)
+        tree.addNode(leaf.second, leaf.first);
 
-    if (smallest != idx) {
-        swapMinHeapNode(&minHeap->array[smallest], &minHeap->array[idx]);
-        minHeapify(minHeap, smallest);
+    // Internal nodes are created in nondecreasing frequency order, so the second queue is a plain FIFO
+    // over the tail of the node array
+    size_t nextLeaf = 0, nextInternal = leaves.size();
+    auto takeMin = [&]() {
+        if (nextLeaf < leaves.size() && (nextInternal >= tree.nodes.size() || tree.nodes[nextLeaf].freq <= tree.nodes[nextInternal].freq))
+            return static_cast<Index>(nextLeaf++);
+        return static_cast<Index>(nextInternal++);
+    };
+    for (size_t merges = 1; merges < leaves.size(); ++merges) {
+        Index left = takeMin();
+        Index right = takeMin();
+        tree.addNode(Symbol(), tree.nodes[left].freq + tree.nodes[right].freq, left, right);
     }
+    tree.root = tree.nodes.empty() ? A::Tree::Node::NO_CHILD : static_cast<Index>(tree.nodes.size() - 1);
 }
 
-MinHeapNode* HuffmanCoding::extractMin(MinHeap* minHeap) {
-    MinHeapNode* temp = minHeap->array[0];
-    minHeap->array[0] = minHeap->array[minHeap->array.size() - 1];
-    minHeap->array.pop_back();
-    minHeapify(minHeap, 0);
-    return temp;
+template <class A>
+void HuffmanCoding::limitCodeLengths(const uint32_t* freq, vector<HuffmanCode>& huffmanCodes) {
+    // Package-merge: the optimal lengths under the limit are found by picking the 2n - 2 cheapest items
+    // from maxLength merged lists of leaves and packages of pairs from the previous list
+    const int maxLength = A::MAX_CODE_LENGTH;
+    vector<pair<uint64_t, size_t>> leaves;
+    for (size_t symbol = 0; symbol < A::SIZE; ++symbol) {
+        if (freq[symbol] != 0)
+            leaves.emplace_back(freq[symbol], symbol);
+    }
+    sort(leaves.begin(), leaves.end());
+    const size_t n = leaves.size();
+    if (n < 2)
+        return;
+
+    struct Item {
+        uint64_t weight; // Total frequency of the leaves in the item
+        bool leaf; // True for a single leaf, false for a package of two items of the previous list
+    };
+    vector<vector<Item>> lists(maxLength);
+    for (const auto& leaf : leaves)
+        lists[0].push_back(Item{leaf.first, true});
+    for (int level = 1; level < maxLength; ++level) {
+        const vector<Item>& previous = lists[level - 1];
+        vector<Item>& current = lists[level];
+        size_t leaf = 0, package = 0;
+        const size_t packages = previous.size() / 2;
+        while (leaf < n || package < packages) {
+            uint64_t packageWeight = package < packages ? previous[2 * package].weight + previous[2 * package + 1].weight : 0;
+            if (package >= packages || (leaf < n && leaves[leaf].first <= packageWeight)) {
+                current.push_back(Item{leaves[leaf++].first, true});
+            } else {
+                current.push_back(Item{packageWeight, false});
+                ++package;
+            }
+        }
+    }
+
+    for (HuffmanCode& code : huffmanCodes)
+        code.length = 0;
+    // Leaves are merged in sorted order, so the k-th leaf of any list prefix is the k-th lightest symbol
+    size_t selected = 2 * n - 2;
+    for (int level = maxLength - 1; level >= 0; --level) {
+        size_t leafCount = 0, packageCount = 0;
+        for (size_t i = 0; i < selected; ++i) {
+            if (lists[level][i].leaf)
+                ++leafCount;
+            else
+                ++packageCount;
+        }
+        for (size_t i = 0; i < leafCount; ++i)
+            huffmanCodes[leaves[i].second].length++;
+        selected = 2 * packageCount;
+    }
 }
 
-void HuffmanCoding::insertMinHeap(MinHeap* minHeap, MinHeapNode* minHeapNode) {
-    minHeap->array.push_back(minHeapNode);
-    int i = minHeap->array.size() - 1;
+template <class A>
+void HuffmanCoding::generateHuffmanCodes(const typename A::Tree& tree, typename A::NodeIndex node, uint64_t bits, int length, vector<HuffmanCode>& huffmanCodes) {
+    if (node == A::Tree::Node::NO_CHILD)
+        return;
 
-    while (i > 0 && minHeap->array[(i - 1) / 2]->freq > minHeap->array[i]->freq) {
-        swap(minHeap->array[i], minHeap->array[(i - 1) / 2]);
-        i = (i - 1) / 2;
+    const auto& current = tree.nodes[node];
+    if (current.isLeaf()) {
+        // Lengths past 63 bits are only clamped here, limitCodeLengths replaces them anyway
+        huffmanCodes[current.data] = HuffmanCode{bits, static_cast<uint8_t>(min(length, 255))};
+        return;
     }
+
+    generateHuffmanCodes<A>(tree, current.left, bits << 1, length + 1, huffmanCodes);
+    generateHuffmanCodes<A>(tree, current.right, (bits << 1) | 1, length + 1, huffmanCodes);
 }
 
-void HuffmanCoding::buildMinHeap(MinHeap* minHeap) {
-    int n = minHeap->array.size() - 1;
-    for (int i = (n - 1) / 2; i >= 0; --i)
-        minHeapify(minHeap, i);
+void HuffmanCoding::writeU32(ostream& out, uint32_t value) {
+    char bytes[4];
+    for (int i = 0; i < 4; ++i)
+        bytes[i] = static_cast<char>(value >> (8 * i));
+    out.write(bytes, 4);
 }
 
-HuffmanCoding::MinHeap* HuffmanCoding::createAndBuildMinHeap(const unordered_map<char, unsigned>& freqmap) {
-    MinHeap* minHeap = new MinHeap;
-    for (const auto& pair : freqmap) {
-        MinHeapNode* temp = new MinHeapNode(pair.first, pair.second);
-        minHeap->array.push_back(temp);
-    }
-    buildMinHeap(minHeap);
-    return minHeap;
+bool HuffmanCoding::readU32(istream& in, uint32_t& value) {
+    unsigned char bytes[4];
+    if (!in.read(reinterpret_cast<char*>(bytes), 4))
+        return false;
+    value = bytes[0] | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+    return true;
 }
 
-MinHeapNode* HuffmanCoding::buildHuffmanTree(const unordered_map<char, unsigned>& freqmap) {
-    MinHeapNode* left, * right, * top;
-    MinHeap* minHeap = createAndBuildMinHeap(freqmap);
+bool HuffmanCoding::readU32(const unsigned char* data, size_t size, size_t& pos, uint32_t& value) {
+    if (size - pos < 4)
+        return false;
+    value = data[pos] | (uint32_t(data[pos + 1]) << 8) | (uint32_t(data[pos + 2]) << 16) | (uint32_t(data[pos + 3]) << 24);
+    pos += 4;
+    return true;
+}
 
-    while (minHeap->array.size() != 1) {
-        left = extractMin(minHeap);
-        right = extractMin(minHeap);
+bool HuffmanCoding::readU64(istream& in, uint64_t& value) {
+    uint32_t low, high;
+    if (!readU32(in, low) || !readU32(in, high))
+        return false;
+    value = low | uint64_t(high) << 32;
+    return true;
+}
+
+bool HuffmanCoding::readU64(const unsigned char* data, size_t size, size_t& pos, uint64_t& value) {
+    uint32_t low, high;
+    if (!readU32(data, size, pos, low) || !readU32(data, size, pos, high))
+        return false;
+    value = low | uint64_t(high) << 32;
+    return true;
+}
 
-        top = new MinHeapNode('$', left->freq + right->freq);
-        top->left = left;
-        top->right = right;
-        insertMinHeap(minHeap, top);
+template <class A>
+bool HuffmanCoding::assignCanonicalCodes(vector<HuffmanCode>& huffmanCodes) {
+    // Codes of each length are consecutive integers in symbol order, shorter codes first
+    size_t lengthCount[A::MAX_CODE_LENGTH + 1] = {0};
+    for (const HuffmanCode& code : huffmanCodes) {
+        if (code.length > A::MAX_CODE_LENGTH)
+            return false;
+        lengthCount[code.length]++;
     }
-    return extractMin(minHeap);
+    lengthCount[0] = 0;
+
+    uint64_t nextCode[A::MAX_CODE_LENGTH + 1] = {0};
+    uint64_t code = 0;
+    for (int length = 1; length <= A::MAX_CODE_LENGTH; ++length) {
+        code = (code + lengthCount[length - 1]) << 1;
+        // Over-subscribed lengths cannot come from a prefix code
+        if (code + lengthCount[length] > (uint64_t(1) << length))
+            return false;
+        nextCode[length] = code;
+    }
+
+    for (HuffmanCode& code : huffmanCodes) {
+        if (code.length > 0)
+            code.bits = nextCode[code.length]++;
+    }
+    return true;
 }
 
-void HuffmanCoding::generateHuffmanCodes(MinHeapNode* root, string code, unordered_map<char, string>& huffmanCodes) {
-    if (!root)
-        return;
+template <class A>
+void HuffmanCoding::writeCodeLengths(const vector<HuffmanCode>& huffmanCodes, vector<unsigned char>& out) {
+    // Lengths are stored one byte each, a zero is followed by the length of the run of absent symbols.
+    // Runs fit a byte in the byte alphabet and are 7-bit varints in larger ones.
+    for (size_t symbol = 0; symbol < A::SIZE;) {
+        if (huffmanCodes[symbol].length != 0) {
+            out.push_back(huffmanCodes[symbol].length);
+            ++symbol;
+            continue;
+        }
+        size_t run = 0;
+        while (symbol + run < A::SIZE && huffmanCodes[symbol + run].length == 0)
+            ++run;
+        out.push_back(0);
+        if (A::SIZE <= 256) {
+            out.push_back(static_cast<unsigned char>(run - 1));
+        } else {
+            size_t value = run - 1;
+            for (; value >= 0x80; value >>= 7)
+                out.push_back(static_cast<unsigned char>(value | 0x80));
+            out.push_back(static_cast<unsigned char>(value));
+        }
+        symbol += run;
+    }
+}
 
-    if (!root->left && !root->right) {
-        huffmanCodes[root->data] = code;
+template <class A>
+bool HuffmanCoding::readCodeLengths(const unsigned char* data, size_t size, size_t& pos, vector<HuffmanCode>& huffmanCodes) {
+    huffmanCodes.assign(A::SIZE, HuffmanCode{0, 0});
+    for (size_t symbol = 0; symbol < A::SIZE;) {
+        if (pos >= size)
+            return false;
+        unsigned char length = data[pos++];
+        if (length != 0) {
+            if (length > A::MAX_CODE_LENGTH)
+                return false;
+            huffmanCodes[symbol++].length = length;
+            continue;
+        }
+        size_t run = 0;
+        for (int shift = 0;; shift += 7) {
+            if (pos >= size || shift > 21)
+                return false;
+            unsigned char byte = data[pos++];
+            run |= size_t(A::SIZE <= 256 ? byte : byte & 0x7F) << shift;
+            if (A::SIZE <= 256 || byte < 0x80)
+                break;
+        }
+        symbol += run + 1;
+    }
+    return true;
+}
+
+template <class A>
+void HuffmanCoding::buildHuffmanCodes(const uint32_t* freq, vector<HuffmanCode>& huffmanCodes) {
+    typename A::Tree tree;
+    buildHuffmanTree<A>(freq, tree);
+    huffmanCodes.assign(A::SIZE, HuffmanCode{0, 0});
+    if (tree.nodes.empty())
         return;
+    generateHuffmanCodes<A>(tree, tree.root, 0, 0, huffmanCodes);
+    // A block of a single repeated symbol still needs one bit per symbol
+    if (tree.nodes[tree.root].isLeaf())
+        huffmanCodes[tree.nodes[tree.root].data].length = 1;
+    // Skewed blocks can produce codes longer than the decode table handles
+    for (const HuffmanCode& code : huffmanCodes) {
+        if (code.length > A::MAX_CODE_LENGTH) {
+            limitCodeLengths<A>(freq, huffmanCodes);
+            break;
+        }
+    }
+    // Only the code lengths are stored, both sides derive the same canonical codes from them
+    assignCanonicalCodes<A>(huffmanCodes);
+}
+
+void HuffmanCoding::appendU32(vector<unsigned char>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+void HuffmanCoding::appendU64(vector<unsigned char>& out, uint64_t value) {
+    appendU32(out, static_cast<uint32_t>(value));
+    appendU32(out, static_cast<uint32_t>(value >> 32));
+}
+
+bool HuffmanCoding::checkStreamHeader(const unsigned char* header) {
+    return memcmp(header, STREAM_MAGIC, 4) == 0 && header[4] == FORMAT_VERSION;
+}
+
+bool HuffmanCoding::checkFrameSizes(char type, uint32_t rawSize, uint32_t payloadSize) {
+    // Checked before anything is allocated for the frame. Stored and run payloads have a fixed size,
+    // no other frame is larger than a stored one except adaptive frames (see compressBound)
+    if (rawSize > MAX_BLOCK_SIZE)
+        return false;
+    switch (type) {
+    case BLOCK_STORED:
+        return payloadSize == rawSize;
+    case BLOCK_RUN:
+        return payloadSize == 1;
+    case BLOCK_ADAPTIVE:
+        return payloadSize <= uint64_t(rawSize) * 3 + 256 * 4 + 1;
+    default:
+        return payloadSize <= rawSize;
     }
+}
+
+bool HuffmanCoding::parseFrame(const unsigned char* data, size_t size, size_t& pos, Frame& frame) {
+    uint32_t payloadSize;
+    if (pos >= size)
+        return false;
+    frame.type = static_cast<char>(data[pos++]);
+    if (!readU32(data, size, pos, frame.rawSize) || !readU32(data, size, pos, payloadSize) || !readU32(data, size, pos, frame.checksum)
+        || !checkFrameSizes(frame.type, frame.rawSize, payloadSize) || payloadSize > size - pos)
+        return false;
+    frame.payload = ByteSpan{data + pos, payloadSize};
+    pos += payloadSize;
+    return true;
+}
+
+void HuffmanCoding::beginFrame(BlockType type, const unsigned char* data, size_t size, vector<unsigned char>& frame) {
+    frame.clear();
+    frame.push_back(static_cast<unsigned char>(type));
+    appendU32(frame, size);
+    appendU32(frame, 0); // Payload size, filled in by endFrame
+    appendU32(frame, crc32c(0, data, size));
+}
+
+void HuffmanCoding::endFrame(vector<unsigned char>& frame) {
+    uint32_t payloadSize = frame.size() - FRAME_HEADER_SIZE;
+    for (int i = 0; i < 4; ++i)
+        frame[5 + i] = static_cast<unsigned char>(payloadSize >> (8 * i));
+}
 
-    generateHuffmanCodes(root->left, code + "0", huffmanCodes);
-    generateHuffmanCodes(root->right, code + "1", huffmanCodes);
+void HuffmanCoding::encodeStoredBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame) {
+    beginFrame(BLOCK_STORED, data, size, frame);
+    frame.reserve(FRAME_HEADER_SIZE + size);
+    frame.insert(frame.end(), data, data + size);
+    endFrame(frame);
 }
 
-void HuffmanCoding::compressFile(const string& inputFile, const string& outputFile) {
-    ifstream inFile(inputFile, ios::binary);
-    if (!inFile) {
-        cerr << "Error opening input file: " << inputFile << endl;
+void HuffmanCoding::encodeBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame) {
+    if (mode == Mode::Adaptive) {
+        // One pass, the model carries over from the previous frame so no table is stored
+        beginFrame(BLOCK_ADAPTIVE, data, size, frame);
+        BitWriter writer(frame);
+        for (size_t i = 0; i < size; ++i)
+            adaptiveEncoder.encode(data[i], writer);
+        writer.flush();
+        endFrame(frame);
+        return;
+    }
+
+    // A block of one byte value is stored as that value in every other mode
+    Histogram freq;
+    countSymbols(data, size, freq);
+    if (size > 0 && freq[data[0]] == size) {
+        beginFrame(BLOCK_RUN, data, size, frame);
+        frame.push_back(data[0]);
+        endFrame(frame);
         return;
     }
-    unordered_map<char, unsigned> freqMap;
-    char ch;
-    while (inFile.get(ch)) {
-        if (ch == 13) {
-            ch = 10;
+
+    if (!sharedCodes.empty()) {
+        // The trained table covers every byte value, only its id is stored
+        uint64_t sharedBits = 0;
+        for (int symbol = 0; symbol < 256; ++symbol)
+            sharedBits += uint64_t(freq[symbol]) * sharedCodes[symbol].length;
+        if (4 + (sharedBits + 7) / 8 >= size) {
+            encodeStoredBlock(data, size, frame);
+            return;
+        }
+        beginFrame(BLOCK_SHARED, data, size, frame);
+        frame.reserve(FRAME_HEADER_SIZE + 4 + size * MAX_CODE_LENGTH / 8 + 8);
+        appendU32(frame, sharedTableId);
+        BitWriter writer(frame);
+        for (size_t i = 0; i < size; ++i) {
+            const HuffmanCode& code = sharedCodes[data[i]];
+            writer.write(code.bits, code.length);
         }
-        freqMap[ch]++;
+        writer.flush();
+        endFrame(frame);
+        return;
     }
-    inFile.close();
 
-    MinHeapNode* root = buildHuffmanTree(freqMap);
-    unordered_map<char, string> huffmanCodes;
-    generateHuffmanCodes(root, "", huffmanCodes);
+    // Context frames fall back to the order-0 frame below when one table codes the block best,
+    // and so do wide, word, LZ and BWT frames when the order-0 or stored frame comes out smaller
+    if (mode == Mode::Context && encodeContextBlock(data, size, frame))
+        return;
+    if (mode == Mode::Wide && size >= MIN_WIDE_SIZE && encodeWideBlock(data, size, frame))
+        return;
+    if (mode == Mode::Words && size >= MIN_WIDE_SIZE && encodeWordsBlock(data, size, frame))
+        return;
+    if (mode == Mode::Lz && encodeLzBlock(data, size, frame))
+        return;
+    if (mode == Mode::Bwt && encodeBwtBlock(data, size, frame))
+        return;
 
-    ofstream outFile(outputFile, ios::binary);
-    if (!outFile) {
-        cerr << "Error opening output file: " << outputFile << endl;
+    // Compressed or random data is stored at copying speed, without building codes it could not repay
+    if (entropyFrameSize(freq) >= FRAME_HEADER_SIZE + size) {
+        encodeStoredBlock(data, size, frame);
         return;
     }
-    for (const auto& pair : huffmanCodes) {
-        outFile << pair.first << pair.second << '\n';
+    vector<HuffmanCode> huffmanCodes;
+    buildHuffmanCodes(freq.data(), huffmanCodes);
+    vector<unsigned char> lengths;
+    writeCodeLengths(huffmanCodes, lengths);
+
+    // The exact encoded size is known from the histogram, so the buffer never reallocates and
+    // blocks the codes would not shrink are still stored
+    uint64_t encodedBits = 0;
+    for (int symbol = 0; symbol < 256; ++symbol)
+        encodedBits += uint64_t(freq[symbol]) * huffmanCodes[symbol].length;
+    const bool split = interleaved && size >= MIN_INTERLEAVED_SIZE;
+    if (lengths.size() + (split ? 12 + encodedBits / 8 + 4 : (encodedBits + 7) / 8) >= size) {
+        encodeStoredBlock(data, size, frame);
+        return;
     }
-    outFile << huffmanCodes.begin()->first << "\n";
 
-    inFile.open(inputFile);
-    if (!inFile) {
-        cerr << "Error reopening input file: " << inputFile << endl;
+    if (split) {
+        // Quarter i of the block becomes stream i, sizes of the first three are patched in afterwards
+        beginFrame(BLOCK_HUFFMAN4, data, size, frame);
+        frame.reserve(FRAME_HEADER_SIZE + lengths.size() + 12 + encodedBits / 8 + 32);
+        frame.insert(frame.end(), lengths.begin(), lengths.end());
+        size_t sizesPos = frame.size();
+        frame.resize(frame.size() + 12);
+        const size_t segment = (size + 3) / 4;
+        for (int stream = 0; stream < 4; ++stream) {
+            size_t streamStart = frame.size();
+            BitWriter writer(frame);
+            for (size_t i = min(stream * segment, size); i < min((stream + 1) * segment, size); ++i) {
+                const HuffmanCode& code = huffmanCodes[data[i]];
+                writer.write(code.bits, code.length);
+            }
+            writer.flush();
+            if (stream < 3) {
+                uint32_t streamSize = frame.size() - streamStart;
+                for (int i = 0; i < 4; ++i)
+                    frame[sizesPos + 4 * stream + i] = static_cast<unsigned char>(streamSize >> (8 * i));
+            }
+        }
+        endFrame(frame);
         return;
     }
-    string encodedText;
-    while (inFile.get(ch)) {
-        encodedText += huffmanCodes[ch];
+
+    beginFrame(BLOCK_HUFFMAN, data, size, frame);
+    frame.reserve(FRAME_HEADER_SIZE + lengths.size() + encodedBits / 8 + 8);
+    frame.insert(frame.end(), lengths.begin(), lengths.end());
+    BitWriter writer(frame);
+    for (size_t i = 0; i < size; ++i) {
+        const HuffmanCode& code = huffmanCodes[data[i]];
+        writer.write(code.bits, code.length);
     }
+    writer.flush();
+    endFrame(frame);
+}
 
-    int padding = (8 - encodedText.length() % 8) % 8;
-    encodedText += string(padding, '0');
+bool HuffmanCoding::encodeContextBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame) {
+    // Histogram of the bytes following each byte value, the first byte of a block follows context 0
+    vector<Histogram> contextFreq(256, Histogram{});
+    unsigned char previous = 0;
+    for (size_t i = 0; i < size; ++i) {
+        ++contextFreq[previous][data[i]];
+        previous = data[i];
+    }
+
+    // Try 1, 2, 4, ... tables and keep the clustering with the smallest exact size, headers included
+    array<uint8_t, 256> bestClusterOf{};
+    vector<vector<HuffmanCode>> bestCodes;
+    uint64_t bestBits = UINT64_MAX;
+    for (int clusterCount = 1; clusterCount <= MAX_CONTEXT_CLUSTERS; clusterCount *= 2) {
+        array<uint8_t, 256> clusterOf;
+        int used = clusterContexts(contextFreq, clusterCount, clusterOf);
+        vector<Histogram> clusterFreq(used, Histogram{});
+        for (int context = 0; context < 256; ++context) {
+            for (int symbol = 0; symbol < 256; ++symbol)
+                clusterFreq[clusterOf[context]][symbol] += contextFreq[context][symbol];
+        }
 
-    for (size_t i = 0; i < encodedText.length(); i += 8) {
-        bitset<8> bits(encodedText.substr(i, 8));
-        char c = static_cast<char>(bits.to_ulong());
-        outFile.put(c);
+        // A single table is written as a plain order-0 frame, without the context map
+        uint64_t bits = used > 1 ? (1 + 128) * 8 : 0;
+        vector<vector<HuffmanCode>> codes(used);
+        vector<unsigned char> lengths;
+        for (int cluster = 0; cluster < used; ++cluster) {
+            buildHuffmanCodes(clusterFreq[cluster].data(), codes[cluster]);
+            writeCodeLengths(codes[cluster], lengths);
+            for (int symbol = 0; symbol < 256; ++symbol)
+                bits += uint64_t(clusterFreq[cluster][symbol]) * codes[cluster][symbol].length;
+        }
+        bits += lengths.size() * 8;
+        if (bits < bestBits) {
+            bestBits = bits;
+            bestClusterOf = clusterOf;
+            bestCodes = move(codes);
+        }
+        if (used < clusterCount)
+            break; // Fewer distinct contexts than tables, more tables cannot help
     }
-    inFile.close();
-    outFile.close();
+    if (bestCodes.size() <= 1 || (bestBits + 7) / 8 >= size)
+        return false;
 
-    cout << "File compressed successfully!" << endl;
+    beginFrame(BLOCK_CONTEXT, data, size, frame);
+    frame.reserve(FRAME_HEADER_SIZE + bestBits / 8 + 8);
+    frame.push_back(static_cast<unsigned char>(bestCodes.size()));
+    for (int context = 0; context < 256; context += 2)
+        frame.push_back(static_cast<unsigned char>(bestClusterOf[context] | (bestClusterOf[context + 1] << 4)));
+    for (const vector<HuffmanCode>& codes : bestCodes)
+        writeCodeLengths(codes, frame);
+
+    const HuffmanCode* contextCodes[256];
+    for (int context = 0; context < 256; ++context)
+        contextCodes[context] = bestCodes[bestClusterOf[context]].data();
+    BitWriter writer(frame);
+    previous = 0;
+    for (size_t i = 0; i < size; ++i) {
+        const HuffmanCode& code = contextCodes[previous][data[i]];
+        writer.write(code.bits, code.length);
+        previous = data[i];
+    }
+    writer.flush();
+    endFrame(frame);
+    return true;
 }
 
-void HuffmanCoding::decompressFile(const string& inputFile, const string& outputFile) {
-    ifstream inFile(inputFile, ios::binary);
-    if (!inFile) {
-        cerr << "Error opening input file: " << inputFile << endl;
-        return;
+uint64_t HuffmanCoding::entropyFrameSize(const Histogram& freq) {
+    // No prefix code beats the Shannon entropy of the histogram, and every byte value present costs
+    // at least one byte of code lengths, so this bounds the order-0 frame from below without building it
+    uint64_t size = 0;
+    int used = 0;
+    for (uint32_t count : freq) {
+        size += count;
+        used += count != 0;
+    }
+    double entropyBits = 0;
+    for (uint32_t count : freq) {
+        if (count != 0)
+            entropyBits += count * log2(double(size) / count);
     }
-    unordered_map<char, string> huffmanCodes;
-    char ch;
-    string code;
-    string line;
-    while (getline(inFile, line)) {
-        ch = line[0];
-        if (ch == 0 || ch == 10 || ch == 13) {
-            ch = '\n';
-            getline(inFile, line);
-            code = line;
+    return FRAME_HEADER_SIZE + used + static_cast<uint64_t>(entropyBits / 8);
+}
+
+uint64_t HuffmanCoding::fallbackFrameSize(const Histogram& freq) {
+    // Size of the order-0 or stored frame of a block, whichever is smaller, which a frame over another
+    // alphabet has to beat
+    uint64_t size = 0;
+    for (uint32_t count : freq)
+        size += count;
+    if (entropyFrameSize(freq) >= FRAME_HEADER_SIZE + size)
+        return FRAME_HEADER_SIZE + size;
+    vector<HuffmanCode> huffmanCodes;
+    buildHuffmanCodes(freq.data(), huffmanCodes);
+    vector<unsigned char> lengths;
+    writeCodeLengths(huffmanCodes, lengths);
+    uint64_t encodedBits = 0;
+    for (int symbol = 0; symbol < 256; ++symbol)
+        encodedBits += uint64_t(freq[symbol]) * huffmanCodes[symbol].length;
+    return min(FRAME_HEADER_SIZE + lengths.size() + (encodedBits + 7) / 8, FRAME_HEADER_SIZE + size);
+}
+
+bool HuffmanCoding::encodeWideBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame) {
+    // Pairs of bytes become one little-endian 16-bit symbol, the odd last byte is stored as is
+    const size_t count = size / 2;
+    vector<uint32_t> freq(WideAlphabet::SIZE, 0);
+    for (size_t i = 0; i < count; ++i)
+        freq[data[2 * i] | data[2 * i + 1] << 8]++;
+    vector<HuffmanCode> huffmanCodes;
+    buildHuffmanCodes<WideAlphabet>(freq.data(), huffmanCodes);
+    vector<unsigned char> lengths;
+    writeCodeLengths<WideAlphabet>(huffmanCodes, lengths);
+    uint64_t encodedBits = 0;
+    for (size_t symbol = 0; symbol < WideAlphabet::SIZE; ++symbol)
+        encodedBits += uint64_t(freq[symbol]) * huffmanCodes[symbol].length;
+
+    // Byte data gains nothing from pairing and pays for a much larger table, it stays order-0
+    Histogram byteFreq;
+    countSymbols(data, size, byteFreq);
+    if (FRAME_HEADER_SIZE + lengths.size() + size % 2 + (encodedBits + 7) / 8 >= fallbackFrameSize(byteFreq))
+        return false;
+
+    beginFrame(BLOCK_WIDE, data, size, frame);
+    frame.reserve(FRAME_HEADER_SIZE + lengths.size() + 1 + encodedBits / 8 + 8);
+    frame.insert(frame.end(), lengths.begin(), lengths.end());
+    if (size % 2 != 0)
+        frame.push_back(data[size - 1]);
+    BitWriter writer(frame);
+    for (size_t i = 0; i < count; ++i) {
+        const HuffmanCode& code = huffmanCodes[data[2 * i] | data[2 * i + 1] << 8];
+        writer.write(code.bits, code.length);
+    }
+    writer.flush();
+    endFrame(frame);
+    return true;
+}
+
+bool HuffmanCoding::encodeWordsBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame) {
+    vector<string_view> dictionary;
+    vector<uint16_t> tokens;
+    if (!tokenizeWords(data, size, dictionary, tokens))
+        return false; // Blocks with more distinct tokens than 16-bit ids stay order-0
+
+    // The dictionary holds the length of every token followed by all their bytes, coded order-0
+    vector<unsigned char> entries;
+    for (const string_view& token : dictionary)
+        entries.push_back(static_cast<unsigned char>(token.size()));
+    for (const string_view& token : dictionary)
+        entries.insert(entries.end(), token.begin(), token.end());
+    Histogram entryFreq;
+    countSymbols(entries.data(), entries.size(), entryFreq);
+    vector<HuffmanCode> entryCodes;
+    buildHuffmanCodes(entryFreq.data(), entryCodes);
+
+    vector<uint32_t> freq(WideAlphabet::SIZE, 0);
+    for (uint16_t token : tokens)
+        freq[token]++;
+    vector<HuffmanCode> tokenCodes;
+    buildHuffmanCodes<WideAlphabet>(freq.data(), tokenCodes);
+
+    beginFrame(BLOCK_WORDS, data, size, frame);
+    appendU32(frame, dictionary.size());
+    appendU32(frame, entries.size());
+    appendU32(frame, tokens.size());
+    writeCodeLengths(entryCodes, frame);
+    size_t codedSizePos = frame.size();
+    frame.resize(frame.size() + 4);
+    BitWriter writer(frame);
+    for (unsigned char byte : entries)
+        writer.write(entryCodes[byte].bits, entryCodes[byte].length);
+    writer.flush();
+    uint32_t codedSize = frame.size() - codedSizePos - 4;
+    for (int i = 0; i < 4; ++i)
+        frame[codedSizePos + i] = static_cast<unsigned char>(codedSize >> (8 * i));
+    writeCodeLengths<WideAlphabet>(tokenCodes, frame);
+    for (uint16_t token : tokens)
+        writer.write(tokenCodes[token].bits, tokenCodes[token].length);
+    writer.flush();
+    endFrame(frame);
+
+    // Text without much repetition of whole words codes smaller byte by byte
+    Histogram byteFreq;
+    countSymbols(data, size, byteFreq);
+    return frame.size() < fallbackFrameSize(byteFreq);
+}
+
+bool HuffmanCoding::encodeLzBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame) {
+    vector<LzToken> tokens;
+    findMatches(data, size, windowSize, tokens);
+
+    vector<uint32_t> literalFreq(LiteralAlphabet::SIZE, 0);
+    vector<uint32_t> distanceFreq(DistanceAlphabet::SIZE, 0);
+    int extraBits;
+    for (const LzToken& token : tokens) {
+        if (token.length == 0) {
+            literalFreq[token.value]++;
+            continue;
+        }
+        literalFreq[256 + bucketOf(token.length - MIN_MATCH, extraBits)]++;
+        distanceFreq[bucketOf(token.value - 1, extraBits)]++;
+    }
+    vector<HuffmanCode> literalCodes, distanceCodes;
+    buildHuffmanCodes<LiteralAlphabet>(literalFreq.data(), literalCodes);
+    buildHuffmanCodes<DistanceAlphabet>(distanceFreq.data(), distanceCodes);
+
+    beginFrame(BLOCK_LZ, data, size, frame);
+    writeCodeLengths<LiteralAlphabet>(literalCodes, frame);
+    writeCodeLengths<DistanceAlphabet>(distanceCodes, frame);
+    BitWriter writer(frame);
+    for (const LzToken& token : tokens) {
+        if (token.length == 0) {
+            const HuffmanCode& code = literalCodes[token.value];
+            writer.write(code.bits, code.length);
+            continue;
+        }
+        uint32_t length = token.length - MIN_MATCH;
+        const HuffmanCode& lengthCode = literalCodes[256 + bucketOf(length, extraBits)];
+        writer.write(lengthCode.bits, lengthCode.length);
+        writer.write(length & ((1u << extraBits) - 1), extraBits);
+        uint32_t distance = token.value - 1;
+        const HuffmanCode& distanceCode = distanceCodes[bucketOf(distance, extraBits)];
+        writer.write(distanceCode.bits, distanceCode.length);
+        writer.write(distance & ((1u << extraBits) - 1), extraBits);
+    }
+    writer.flush();
+    endFrame(frame);
+
+    // Blocks without repeated strings code smaller byte by byte
+    Histogram byteFreq;
+    countSymbols(data, size, byteFreq);
+    return frame.size() < fallbackFrameSize(byteFreq);
+}
+
+bool HuffmanCoding::encodeBwtBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame) {
+    if (size == 0)
+        return false;
+    // Sorting the rotations of the block and a sentinel groups bytes by what follows them. Row 0 is the
+    // sentinel's own, its last byte ends the block, and the row of the whole block ends in the sentinel,
+    // so only that row's number is stored in place of it. The rows of the rotations starting at the
+    // quarters of the block let the decoder rebuild the quarters side by side
+    vector<int32_t> suffixes;
+    buildSuffixArray(data, size, suffixes);
+    vector<unsigned char> last(size);
+    last[0] = data[size - 1];
+    uint32_t primary = 0;
+    const size_t segment = (size + 3) / 4;
+    array<uint32_t, 3> quarterRows = {0, 0, 0};
+    for (size_t i = 0, j = 1; i < size; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            if (size_t(suffixes[i]) == (k + 1) * segment)
+                quarterRows[k] = static_cast<uint32_t>(i + 1);
+        }
+        if (suffixes[i] == 0)
+            primary = static_cast<uint32_t>(i + 1);
+        else
+            last[j++] = data[suffixes[i] - 1];
+    }
+    suffixes = vector<int32_t>();
+
+    // Move-to-front turns the groups into small ranks, and each run of rank 0 is written in bijective
+    // base 2 with RUN_A and RUN_B digits, least significant first
+    vector<uint16_t> symbols;
+    symbols.reserve(size);
+    array<unsigned char, 256> order;
+    for (int i = 0; i < 256; ++i)
+        order[i] = static_cast<unsigned char>(i);
+    size_t run = 0;
+    auto endRun = [&]() {
+        while (run > 0) {
+            --run;
+            symbols.push_back(run & 1 ? RUN_B : RUN_A);
+            run >>= 1;
+        }
+    };
+    for (size_t i = 0; i < size; ++i) {
+        unsigned char byte = last[i];
+        if (order[0] == byte) {
+            ++run;
+            continue;
+        }
+        endRun();
+        unsigned char previous = order[0];
+        order[0] = byte;
+        size_t rank = 1;
+        while (order[rank] != byte)
+            swap(previous, order[rank++]);
+        order[rank] = previous;
+        symbols.push_back(static_cast<uint16_t>(rank + 1));
+    }
+    endRun();
+
+    vector<uint32_t> freq(MtfAlphabet::SIZE, 0);
+    for (uint16_t symbol : symbols)
+        freq[symbol]++;
+    vector<HuffmanCode> huffmanCodes;
+    buildHuffmanCodes<MtfAlphabet>(freq.data(), huffmanCodes);
+    vector<unsigned char> lengths;
+    writeCodeLengths<MtfAlphabet>(huffmanCodes, lengths);
+    uint64_t encodedBits = 0;
+    for (size_t symbol = 0; symbol < MtfAlphabet::SIZE; ++symbol)
+        encodedBits += uint64_t(freq[symbol]) * huffmanCodes[symbol].length;
+
+    // Data without repeated contexts, such as noise, gains nothing from the transform
+    Histogram byteFreq;
+    countSymbols(data, size, byteFreq);
+    if (FRAME_HEADER_SIZE + 16 + lengths.size() + (encodedBits + 7) / 8 >= fallbackFrameSize(byteFreq))
+        return false;
+
+    beginFrame(BLOCK_BWT, data, size, frame);
+    frame.reserve(FRAME_HEADER_SIZE + 16 + lengths.size() + encodedBits / 8 + 8);
+    appendU32(frame, primary);
+    for (uint32_t row : quarterRows)
+        appendU32(frame, row);
+    frame.insert(frame.end(), lengths.begin(), lengths.end());
+    BitWriter writer(frame);
+    for (uint16_t symbol : symbols) {
+        const HuffmanCode& code = huffmanCodes[symbol];
+        writer.write(code.bits, code.length);
+    }
+    writer.flush();
+    endFrame(frame);
+    return true;
+}
+
+void HuffmanCoding::buildDecodeTable(const vector<HuffmanCode>& huffmanCodes, vector<DecodeEntry>& table) {
+    const int primarySize = 1 << PRIMARY_TABLE_BITS;
+    table.assign(primarySize, DecodeEntry{0, {0, 0}, 0, 0, 0});
+
+    // Sub-table width needed under each primary prefix for codes longer than the primary index
+    vector<int> subBits(primarySize, 0);
+    for (const HuffmanCode& code : huffmanCodes) {
+        if (code.length > PRIMARY_TABLE_BITS) {
+            uint32_t prefix = code.bits >> (code.length - PRIMARY_TABLE_BITS);
+            subBits[prefix] = max(subBits[prefix], code.length - PRIMARY_TABLE_BITS);
+        }
+    }
+    for (int prefix = 0; prefix < primarySize; ++prefix) {
+        if (subBits[prefix] == 0)
+            continue;
+        table[prefix].link = table.size();
+        table[prefix].length = subBits[prefix];
+        table.resize(table.size() + (size_t(1) << subBits[prefix]), DecodeEntry{0, {0, 0}, 0, 0, 0});
+    }
+
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        const HuffmanCode& code = huffmanCodes[symbol];
+        if (code.length == 0)
+            continue;
+        DecodeEntry entry{0, {static_cast<unsigned char>(symbol), 0}, 1, code.length, code.length};
+        size_t first, count;
+        if (code.length <= PRIMARY_TABLE_BITS) {
+            first = size_t(code.bits) << (PRIMARY_TABLE_BITS - code.length);
+            count = size_t(1) << (PRIMARY_TABLE_BITS - code.length);
         } else {
-            code = line.substr(1);
+            int suffixBits = code.length - PRIMARY_TABLE_BITS;
+            const DecodeEntry& link = table[code.bits >> suffixBits];
+            first = link.link + ((size_t(code.bits) & ((size_t(1) << suffixBits) - 1)) << (link.length - suffixBits));
+            count = size_t(1) << (link.length - suffixBits);
         }
-        if (huffmanCodes.find(ch) != huffmanCodes.end()) {
-            break;
+        for (size_t j = first; j < first + count; ++j)
+            table[j] = entry;
+    }
+
+    // Pack a second symbol into primary entries whose remaining index bits hold a whole code
+    vector<DecodeEntry> single(table.begin(), table.begin() + primarySize);
+    for (int idx = 0; idx < primarySize; ++idx) {
+        const DecodeEntry& first = single[idx];
+        if (first.count != 1 || first.length >= PRIMARY_TABLE_BITS)
+            continue;
+        const DecodeEntry& second = single[(idx << first.length) & (primarySize - 1)];
+        if (second.count != 1 || second.length > PRIMARY_TABLE_BITS - first.length)
+            continue;
+        table[idx].symbols[1] = second.symbols[0];
+        table[idx].count = 2;
+        table[idx].length = first.length + second.length;
+    }
+}
+
+template <class A>
+void HuffmanCoding::buildSymbolTable(const vector<HuffmanCode>& huffmanCodes, vector<SymbolEntry<A>>& table) {
+    // Same layout as buildDecodeTable without the symbol pairs, which would double the entry size
+    const size_t primarySize = size_t(1) << A::PRIMARY_TABLE_BITS;
+    table.assign(primarySize, SymbolEntry<A>{0, 0, 0, 0});
+
+    vector<int> subBits(primarySize, 0);
+    for (const HuffmanCode& code : huffmanCodes) {
+        if (code.length > A::PRIMARY_TABLE_BITS) {
+            size_t prefix = code.bits >> (code.length - A::PRIMARY_TABLE_BITS);
+            subBits[prefix] = max(subBits[prefix], code.length - A::PRIMARY_TABLE_BITS);
         }
-        huffmanCodes[ch] = code;
+    }
+    for (size_t prefix = 0; prefix < primarySize; ++prefix) {
+        if (subBits[prefix] == 0)
+            continue;
+        table[prefix].link = table.size();
+        table[prefix].length = subBits[prefix];
+        table.resize(table.size() + (size_t(1) << subBits[prefix]), SymbolEntry<A>{0, 0, 0, 0});
     }
 
-    MinHeapNode* root = new MinHeapNode('$', 0);
-    for (const auto& pair : huffmanCodes) {
-        MinHeapNode* current = root;
-        for (char c : pair.second) {
-            if (c == '0') {
-                if (!current->left) {
-                    current->left = new MinHeapNode('$', 0);
-                }
-                current = current->left;
-            } else if (c == '1') {
-                if (!current->right) {
-                    current->right = new MinHeapNode('$', 0);
-                }
-                current = current->right;
+    for (size_t symbol = 0; symbol < A::SIZE; ++symbol) {
+        const HuffmanCode& code = huffmanCodes[symbol];
+        if (code.length == 0)
+            continue;
+        SymbolEntry<A> entry{0, static_cast<typename A::SymbolType>(symbol), 1, code.length};
+        size_t first, count;
+        if (code.length <= A::PRIMARY_TABLE_BITS) {
+            first = size_t(code.bits) << (A::PRIMARY_TABLE_BITS - code.length);
+            count = size_t(1) << (A::PRIMARY_TABLE_BITS - code.length);
+        } else {
+            int suffixBits = code.length - A::PRIMARY_TABLE_BITS;
+            const SymbolEntry<A>& link = table[code.bits >> suffixBits];
+            first = link.link + ((size_t(code.bits) & ((size_t(1) << suffixBits) - 1)) << (link.length - suffixBits));
+            count = size_t(1) << (link.length - suffixBits);
+        }
+        for (size_t j = first; j < first + count; ++j)
+            table[j] = entry;
+    }
+}
+
+// Decode the next symbol of a refilled reader
+template <class A>
+inline bool HuffmanCoding::decodeSymbol(const SymbolEntry<A>* table, BitReader& reader, typename A::SymbolType& symbol) {
+    const SymbolEntry<A>* entry = &table[reader.buffer >> (64 - A::PRIMARY_TABLE_BITS)];
+    if (entry->count == 0 && entry->length != 0)
+        entry = &table[entry->link + ((reader.buffer << A::PRIMARY_TABLE_BITS) >> (64 - entry->length))];
+    if (entry->count == 0)
+        return false;
+    symbol = entry->symbol;
+    reader.buffer <<= entry->length;
+    reader.count -= entry->length;
+    return true;
+}
+
+// Decode count symbols and hand each to store(index, symbol), which returns false to reject it
+template <class A, class Store>
+bool HuffmanCoding::decodeSymbols(const vector<SymbolEntry<A>>& table, const unsigned char* data, size_t size, size_t count, Store store) {
+    const SymbolEntry<A>* lookup = table.data();
+    BitReader reader(data, size);
+    typename A::SymbolType symbol;
+    for (size_t i = 0; i < count; ++i) {
+        reader.refill();
+        if (!decodeSymbol(lookup, reader, symbol) || !store(i, symbol))
+            return false;
+    }
+    // Reading past the end of the payload means the block was truncated
+    return reader.count >= 0;
+}
+
+bool HuffmanCoding::decodeWideBlock(const unsigned char* payload, size_t payloadSize, unsigned char* out, size_t count) {
+    size_t pos = 0;
+    vector<HuffmanCode> huffmanCodes;
+    if (!readCodeLengths<WideAlphabet>(payload, payloadSize, pos, huffmanCodes) || !assignCanonicalCodes<WideAlphabet>(huffmanCodes))
+        return false;
+    if (count % 2 != 0) {
+        if (pos >= payloadSize)
+            return false;
+        out[count - 1] = payload[pos++];
+    }
+    vector<SymbolEntry<WideAlphabet>> table;
+    buildSymbolTable(huffmanCodes, table);
+    return decodeSymbols(table, payload + pos, payloadSize - pos, count / 2, [out](size_t i, uint16_t symbol) {
+        out[2 * i] = static_cast<unsigned char>(symbol);
+        out[2 * i + 1] = static_cast<unsigned char>(symbol >> 8);
+        return true;
+    });
+}
+
+bool HuffmanCoding::decodeWordsBlock(const unsigned char* payload, size_t payloadSize, unsigned char* out, size_t count) {
+    size_t pos = 0;
+    uint32_t tokenCount, entrySize, idCount, codedSize;
+    vector<HuffmanCode> huffmanCodes;
+    if (!readU32(payload, payloadSize, pos, tokenCount) || !readU32(payload, payloadSize, pos, entrySize) || !readU32(payload, payloadSize, pos, idCount)
+        || tokenCount > WideAlphabet::SIZE || tokenCount > entrySize || entrySize > tokenCount * (MAX_TOKEN_LENGTH + 1) || idCount > count
+        || !readCodeLengths(payload, payloadSize, pos, huffmanCodes) || !assignCanonicalCodes(huffmanCodes)
+        || !readU32(payload, payloadSize, pos, codedSize) || codedSize > payloadSize - pos)
+        return false;
+
+    // Token lengths come first in the dictionary, then the bytes of all tokens
+    vector<unsigned char> entries(entrySize);
+    vector<DecodeEntry> entryTable;
+    buildDecodeTable(huffmanCodes, entryTable);
+    if (!decodeWithTable(entryTable, payload + pos, codedSize, entries.data(), entrySize))
+        return false;
+    pos += codedSize;
+    vector<uint32_t> offsets(tokenCount + 1);
+    offsets[0] = tokenCount;
+    for (uint32_t i = 0; i < tokenCount; ++i)
+        offsets[i + 1] = offsets[i] + entries[i];
+    if (offsets[tokenCount] != entrySize)
+        return false;
+
+    if (!readCodeLengths<WideAlphabet>(payload, payloadSize, pos, huffmanCodes) || !assignCanonicalCodes<WideAlphabet>(huffmanCodes))
+        return false;
+    vector<SymbolEntry<WideAlphabet>> table;
+    buildSymbolTable(huffmanCodes, table);
+    size_t written = 0;
+    bool ok = decodeSymbols(table, payload + pos, payloadSize - pos, idCount, [&](size_t, uint16_t id) {
+        if (id >= tokenCount || offsets[id + 1] - offsets[id] > count - written)
+            return false;
+        memcpy(out + written, entries.data() + offsets[id], offsets[id + 1] - offsets[id]);
+        written += offsets[id + 1] - offsets[id];
+        return true;
+    });
+    return ok && written == count;
+}
+
+uint32_t HuffmanCoding::readBucket(uint32_t bucket, BitReader& reader) {
+    if (bucket < 4)
+        return bucket;
+    int extraBits = bucket / 2 - 1;
+    uint32_t extra = static_cast<uint32_t>(reader.buffer >> (64 - extraBits));
+    reader.buffer <<= extraBits;
+    reader.count -= extraBits;
+    return ((2 | (bucket & 1)) << extraBits) | extra;
+}
+
+bool HuffmanCoding::decodeLzBlock(const unsigned char* payload, size_t payloadSize, unsigned char* out, size_t count) {
+    size_t pos = 0;
+    vector<HuffmanCode> literalCodes, distanceCodes;
+    if (!readCodeLengths<LiteralAlphabet>(payload, payloadSize, pos, literalCodes) || !assignCanonicalCodes<LiteralAlphabet>(literalCodes)
+        || !readCodeLengths<DistanceAlphabet>(payload, payloadSize, pos, distanceCodes) || !assignCanonicalCodes<DistanceAlphabet>(distanceCodes))
+        return false;
+    vector<SymbolEntry<LiteralAlphabet>> literalTable;
+    vector<SymbolEntry<DistanceAlphabet>> distanceTable;
+    buildSymbolTable(literalCodes, literalTable);
+    buildSymbolTable(distanceCodes, distanceTable);
+
+    // A refill covers a literal or length code with its extra bits, the distance gets a second one
+    BitReader reader(payload + pos, payloadSize - pos);
+    size_t written = 0;
+    uint16_t symbol;
+    uint8_t distanceSymbol;
+    while (written < count) {
+        reader.refill();
+        if (!decodeSymbol(literalTable.data(), reader, symbol))
+            return false;
+        if (symbol < 256) {
+            out[written++] = static_cast<unsigned char>(symbol);
+            continue;
+        }
+        size_t length = MIN_MATCH + readBucket(symbol - 256, reader);
+        reader.refill();
+        if (!decodeSymbol(distanceTable.data(), reader, distanceSymbol))
+            return false;
+        size_t distance = 1 + size_t(readBucket(distanceSymbol, reader));
+        if (distance > written || length > count - written)
+            return false;
+        // Overlapping matches repeat the bytes they are still writing, so they are copied forwards
+        const unsigned char* from = out + written - distance;
+        unsigned char* to = out + written;
+        if (distance >= length) {
+            memcpy(to, from, length);
+        } else {
+            for (size_t i = 0; i < length; ++i)
+                to[i] = from[i];
+        }
+        written += length;
+    }
+    return reader.count >= 0;
+}
+
+bool HuffmanCoding::decodeBwtBlock(const unsigned char* payload, size_t payloadSize, unsigned char* out, size_t count) {
+    size_t pos = 0;
+    uint32_t primary;
+    array<uint32_t, 4> rows = {0, 0, 0, 0};
+    vector<HuffmanCode> huffmanCodes;
+    if (!readU32(payload, payloadSize, pos, primary) || primary == 0 || primary > count)
+        return false;
+    for (int k = 0; k < 3; ++k) {
+        if (!readU32(payload, payloadSize, pos, rows[k]) || rows[k] > count)
+            return false;
+    }
+    if (!readCodeLengths<MtfAlphabet>(payload, payloadSize, pos, huffmanCodes) || !assignCanonicalCodes<MtfAlphabet>(huffmanCodes))
+        return false;
+    vector<SymbolEntry<MtfAlphabet>> table;
+    buildSymbolTable(huffmanCodes, table);
+
+    // Undo the zero runs and move-to-front, the last run is complete once it fills the block
+    vector<unsigned char> last(count + 1);
+    array<unsigned char, 256> order;
+    for (int i = 0; i < 256; ++i)
+        order[i] = static_cast<unsigned char>(i);
+    BitReader reader(payload + pos, payloadSize - pos);
+    size_t written = 0, run = 0, weight = 1;
+    uint16_t symbol;
+    while (written + run < count) {
+        reader.refill();
+        if (!decodeSymbol(table.data(), reader, symbol))
+            return false;
+        if (symbol <= RUN_B) {
+            run += (symbol + 1) * weight;
+            weight <<= 1;
+            if (run > count - written)
+                return false;
+            continue;
+        }
+        memset(last.data() + written, order[0], run);
+        written += run;
+        run = 0;
+        weight = 1;
+        size_t rank = symbol - 1;
+        unsigned char byte = order[rank];
+        memmove(order.data() + 1, order.data(), rank);
+        order[0] = byte;
+        last[written++] = byte;
+    }
+    memset(last.data() + written, order[0], run);
+    if (reader.count < 0)
+        return false;
+
+    // The occurrences of a byte in the last column come in the same order as the rows starting with it,
+    // which maps each row to the row of the rotation one byte earlier. The sentinel's row is put back first
+    Histogram freq;
+    countSymbols(last.data(), count, freq);
+    array<uint32_t, 256> start;
+    uint32_t total = 1;
+    for (int byte = 0; byte < 256; ++byte) {
+        start[byte] = total;
+        total += freq[byte];
+    }
+    memmove(last.data() + primary + 1, last.data() + primary, count - primary);
+    vector<uint32_t> previousRow(count + 1, 0);
+    for (size_t row = 0; row <= count; ++row) {
+        if (row != primary)
+            previousRow[row] = start[last[row]]++;
+    }
+
+    // Each quarter is rebuilt backwards from the row of the rotation after it, row 0 for the last one.
+    // The walks jump around the whole block, four of them keep four cache misses in flight
+    const size_t segment = (count + 3) / 4;
+    array<size_t, 4> ends, lengths;
+    for (int k = 0; k < 4; ++k) {
+        ends[k] = min((k + 1) * segment, count);
+        lengths[k] = ends[k] - min(k * segment, count);
+    }
+    for (size_t i = 0; i < segment; ++i) {
+        if (i < lengths[3]) {
+            for (int k = 0; k < 4; ++k) {
+                out[ends[k] - 1 - i] = last[rows[k]];
+                rows[k] = previousRow[rows[k]];
+            }
+            continue;
+        }
+        for (int k = 0; k < 3; ++k) {
+            if (i < lengths[k]) {
+                out[ends[k] - 1 - i] = last[rows[k]];
+                rows[k] = previousRow[rows[k]];
             }
         }
-        current->data = pair.first;
     }
+    return true;
+}
 
-    ofstream outFile(outputFile);
-    if (!outFile) {
-        cerr << "Error opening output file: " << outputFile << endl;
-        return;
+// Decode the next entry of a refilled reader, one or two symbols
+inline bool HuffmanCoding::decodeStep(const DecodeEntry* table, BitReader& reader, unsigned char*& out, unsigned char* end) {
+    const DecodeEntry* entry = &table[reader.buffer >> (64 - PRIMARY_TABLE_BITS)];
+    if (entry->count == 0 && entry->length != 0)
+        entry = &table[entry->link + ((reader.buffer << PRIMARY_TABLE_BITS) >> (64 - entry->length))];
+    if (entry->count == 0)
+        return false;
+
+    if (entry->count == 2 && end - out >= 2) {
+        out[0] = entry->symbols[0];
+        out[1] = entry->symbols[1];
+        out += 2;
+        reader.buffer <<= entry->length;
+        reader.count -= entry->length;
+    } else {
+        *out++ = entry->symbols[0];
+        reader.buffer <<= entry->firstLength;
+        reader.count -= entry->firstLength;
+    }
+    return true;
+}
+
+bool HuffmanCoding::decodeWithTable(const vector<DecodeEntry>& table, const unsigned char* data, size_t size, unsigned char* out, size_t count) {
+    unsigned char* const end = out + count;
+    const DecodeEntry* lookup = table.data();
+    BitReader reader(data, size);
+    while (out < end) {
+        reader.refill();
+        if (!decodeStep(lookup, reader, out, end))
+            return false;
+    }
+    // Reading past the end of the payload means the block was truncated
+    return reader.count >= 0;
+}
+
+bool HuffmanCoding::decodeInterleaved(const vector<DecodeEntry>& table, const array<ByteSpan, 4>& streams, unsigned char* out, size_t count) {
+    const size_t segment = (count + 3) / 4;
+    BitReader readers[4] = {{streams[0].data, streams[0].size}, {streams[1].data, streams[1].size},
+                            {streams[2].data, streams[2].size}, {streams[3].data, streams[3].size}};
+    unsigned char* outs[4];
+    unsigned char* ends[4];
+    for (int i = 0; i < 4; ++i) {
+        outs[i] = out + min(i * segment, count);
+        ends[i] = out + min((i + 1) * segment, count);
+    }
+
+    // The four chains are independent, so each round keeps four lookups in flight. A refill
+    // leaves at least 56 bits, enough for four entries of at most 15 bits per stream.
+    const DecodeEntry* lookup = table.data();
+    while (ends[3] - outs[3] >= 8 && ends[2] - outs[2] >= 8 && ends[1] - outs[1] >= 8 && ends[0] - outs[0] >= 8) {
+        for (int i = 0; i < 4; ++i)
+            readers[i].refill();
+        for (int step = 0; step < 3; ++step) {
+            for (int i = 0; i < 4; ++i) {
+                if (!decodeStep(lookup, readers[i], outs[i], ends[i]))
+                    return false;
+            }
+        }
+    }
+
+    // Each stream finishes on its own
+    for (int i = 0; i < 4; ++i) {
+        while (outs[i] < ends[i]) {
+            readers[i].refill();
+            if (!decodeStep(lookup, readers[i], outs[i], ends[i]))
+                return false;
+        }
+        if (readers[i].count < 0)
+            return false;
     }
+    return true;
+}
+
+bool HuffmanCoding::decodeWithContextTables(const vector<vector<DecodeEntry>>& tables, const array<uint8_t, 256>& clusterOf, const unsigned char* data, size_t size, unsigned char* out, size_t count) {
+    // Like decodeWithTable, but one symbol per probe because the next symbol may use another table
+    const DecodeEntry* contextTable[256];
+    for (int context = 0; context < 256; ++context)
+        contextTable[context] = tables[clusterOf[context]].data();
+    unsigned char* const end = out + count;
+    BitReader reader(data, size);
+    unsigned char previous = 0;
+
+    while (out < end) {
+        reader.refill();
+        const DecodeEntry* table = contextTable[previous];
+        const DecodeEntry* entry = &table[reader.buffer >> (64 - PRIMARY_TABLE_BITS)];
+        if (entry->count == 0 && entry->length != 0)
+            entry = &table[entry->link + ((reader.buffer << PRIMARY_TABLE_BITS) >> (64 - entry->length))];
+        if (entry->count == 0)
+            return false;
+
+        previous = *out++ = entry->symbols[0];
+        reader.buffer <<= entry->firstLength;
+        reader.count -= entry->firstLength;
+    }
+    // Reading past the end of the payload means the block was truncated
+    return reader.count >= 0;
+}
 
-    MinHeapNode* current = root;
-    while (inFile.get(ch)) {
-        bitset<8> bits(ch);
-        for (int i = 7; i >= 0; --i) {
+bool HuffmanCoding::decodeWithTree(const HuffmanTree& tree, const unsigned char* data, size_t size, unsigned char* out, size_t count) {
+    unsigned char* const end = out + count;
+    uint16_t current = tree.root;
+    for (size_t pos = 0; pos < size && out < end; ++pos) {
+        bitset<8> bits(data[pos]);
+        for (int i = 7; i >= 0 && out < end; --i) {
             if (bits[i] == 0) {
-                current = current->left;
+                current = tree.nodes[current].left;
             } else {
-                current = current->right;
+                current = tree.nodes[current].right;
             }
-            if (!current->left && !current->right) {
-                outFile << current->data;
-                current = root;
+            if (current == MinHeapNode::NO_CHILD)
+                return false;
+            if (tree.nodes[current].isLeaf()) {
+                *out++ = tree.nodes[current].data;
+                current = tree.root;
+            }
+        }
+    }
+    return out == end;
+}
+
+void HuffmanCoding::buildDecodeTree(const vector<HuffmanCode>& huffmanCodes, HuffmanTree& tree) {
+    tree.nodes.clear();
+    tree.root = tree.addNode(0, 0);
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        const HuffmanCode& code = huffmanCodes[symbol];
+        if (code.length == 0)
+            continue;
+        uint16_t current = tree.root;
+        for (int bit = code.length - 1; bit >= 0; --bit) {
+            // Children are appended after the parent reference is read, the array may reallocate
+            if (((code.bits >> bit) & 1) == 0) {
+                if (tree.nodes[current].left == MinHeapNode::NO_CHILD) {
+                    uint16_t child = tree.addNode(0, 0);
+                    tree.nodes[current].left = child;
+                }
+                current = tree.nodes[current].left;
+            } else {
+                if (tree.nodes[current].right == MinHeapNode::NO_CHILD) {
+                    uint16_t child = tree.addNode(0, 0);
+                    tree.nodes[current].right = child;
+                }
+                current = tree.nodes[current].right;
+            }
+        }
+        tree.nodes[current].data = static_cast<unsigned char>(symbol);
+    }
+}
+
+bool HuffmanCoding::decodeFrame(const Frame& frame, vector<unsigned char>& block, DecoderType decoder) {
+    // The checksum runs on the worker that decoded the block while it is still in cache. A block too
+    // large for the memory left fails like a corrupt one, also on pool threads
+    try {
+        block.resize(frame.rawSize);
+        return decodeBlock(frame, block.data(), decoder) && crc32c(0, block.data(), block.size()) == frame.checksum;
+    } catch (const bad_alloc&) {
+        return false;
+    }
+}
+
+bool HuffmanCoding::decodeBlock(const Frame& frame, unsigned char* out, DecoderType decoder) {
+    const unsigned char* payload = frame.payload.data;
+    size_t payloadSize = frame.payload.size;
+    size_t pos = 0;
+    vector<HuffmanCode> blockCodes;
+    const vector<HuffmanCode>* huffmanCodes = &blockCodes;
+    const vector<DecodeEntry>* sharedTable = nullptr;
+    int streamCount = 1;
+    uint32_t streamSizes[3];
+
+    switch (frame.type) {
+    case BLOCK_ADAPTIVE: {
+        // Frames of one stream share the model, pipeBlocks decodes them in order
+        size_t bitPos = 0;
+        for (size_t i = 0; i < frame.rawSize; ++i) {
+            if (!adaptiveDecoder.decode(payload, payloadSize, bitPos, out[i]))
+                return false;
+        }
+        return true;
+    }
+    case BLOCK_CONTEXT: {
+        // Context frames are always decoded with tables, one per cluster
+        if (pos >= payloadSize)
+            return false;
+        size_t clusterCount = payload[pos++];
+        if (clusterCount < 1 || clusterCount > MAX_CONTEXT_CLUSTERS || payloadSize - pos < 128)
+            return false;
+        array<uint8_t, 256> clusterOf;
+        for (int i = 0; i < 128; ++i) {
+            clusterOf[2 * i] = payload[pos] & 15;
+            clusterOf[2 * i + 1] = payload[pos++] >> 4;
+            if (clusterOf[2 * i] >= clusterCount || clusterOf[2 * i + 1] >= clusterCount)
+                return false;
+        }
+        vector<vector<DecodeEntry>> tables(clusterCount);
+        for (vector<DecodeEntry>& table : tables) {
+            if (!readCodeLengths(payload, payloadSize, pos, blockCodes) || !assignCanonicalCodes(blockCodes))
+                return false;
+            buildDecodeTable(blockCodes, table);
+        }
+        return decodeWithContextTables(tables, clusterOf, payload + pos, payloadSize - pos, out, frame.rawSize);
+    }
+    case BLOCK_WIDE:
+        // Frames over wider alphabets are always decoded with tables
+        return decodeWideBlock(payload, payloadSize, out, frame.rawSize);
+    case BLOCK_WORDS:
+        return decodeWordsBlock(payload, payloadSize, out, frame.rawSize);
+    case BLOCK_LZ:
+        return decodeLzBlock(payload, payloadSize, out, frame.rawSize);
+    case BLOCK_BWT:
+        return decodeBwtBlock(payload, payloadSize, out, frame.rawSize);
+    case BLOCK_STORED:
+        if (payloadSize != frame.rawSize)
+            return false;
+        memcpy(out, payload, payloadSize);
+        return true;
+    case BLOCK_RUN:
+        if (payloadSize != 1)
+            return false;
+        memset(out, payload[0], frame.rawSize);
+        return true;
+    case BLOCK_HUFFMAN:
+        if (!readCodeLengths(payload, payloadSize, pos, blockCodes) || !assignCanonicalCodes(blockCodes))
+            return false;
+        break;
+    case BLOCK_HUFFMAN4:
+        if (!readCodeLengths(payload, payloadSize, pos, blockCodes) || !assignCanonicalCodes(blockCodes))
+            return false;
+        streamCount = 4;
+        for (int i = 0; i < 3; ++i) {
+            if (!readU32(payload, payloadSize, pos, streamSizes[i]))
+                return false;
+        }
+        break;
+    case BLOCK_SHARED: {
+        // The block was written with a trained table, which must be the one loaded here
+        uint32_t tableId;
+        if (sharedCodes.empty() || !readU32(payload, payloadSize, pos, tableId) || tableId != sharedTableId)
+            return false;
+        huffmanCodes = &sharedCodes;
+        sharedTable = &sharedDecodeTable;
+        break;
+    }
+    default:
+        return false;
+    }
+    const unsigned char* data = payload + pos;
+    size_t size = payloadSize - pos;
+
+    if (streamCount == 4) {
+        array<ByteSpan, 4> streams;
+        for (int i = 0; i < 3; ++i) {
+            if (streamSizes[i] > size)
+                return false;
+            streams[i] = ByteSpan{data, streamSizes[i]};
+            data += streamSizes[i];
+            size -= streamSizes[i];
+        }
+        streams[3] = ByteSpan{data, size};
+        if (decoder == DecoderType::Table) {
+            vector<DecodeEntry> table;
+            buildDecodeTable(*huffmanCodes, table);
+            return decodeInterleaved(table, streams, out, frame.rawSize);
+        }
+        HuffmanTree tree;
+        buildDecodeTree(*huffmanCodes, tree);
+        const size_t segment = (frame.rawSize + 3) / 4;
+        for (int i = 0; i < 4; ++i) {
+            size_t start = min(i * segment, size_t(frame.rawSize));
+            size_t length = min((i + 1) * segment, size_t(frame.rawSize)) - start;
+            if (!decodeWithTree(tree, streams[i].data, streams[i].size, out + start, length))
+                return false;
+        }
+        return true;
+    }
+
+    if (decoder == DecoderType::Table) {
+        if (sharedTable)
+            return decodeWithTable(*sharedTable, data, size, out, frame.rawSize);
+        vector<DecodeEntry> table;
+        buildDecodeTable(*huffmanCodes, table);
+        return decodeWithTable(table, data, size, out, frame.rawSize);
+    }
+
+    HuffmanTree tree;
+    buildDecodeTree(*huffmanCodes, tree);
+    return decodeWithTree(tree, data, size, out, frame.rawSize);
+}
+
+void HuffmanCoding::setBlockSize(size_t size) {
+    blockSize = max<size_t>(1, min<size_t>(size, MAX_BLOCK_SIZE));
+}
+
+void HuffmanCoding::setMode(Mode newMode) {
+    mode = newMode;
+}
+
+void HuffmanCoding::setInterleaved(bool enabled) {
+    interleaved = enabled;
+}
+
+void HuffmanCoding::setWindowSize(size_t size) {
+    windowSize = max<size_t>(1, min(size, MAX_WINDOW_SIZE));
+}
+
+void HuffmanCoding::setSeekIndex(bool enabled) {
+    writeIndex = enabled;
+}
+
+void HuffmanCoding::setThreadCount(unsigned threads) {
+    threadCount = max(1u, threads);
+    pool.reset();
+}
+
+void HuffmanCoding::setProgressCallback(ProgressCallback callback) {
+    progress = move(callback);
+}
+
+void HuffmanCoding::startProgress(uint64_t total) {
+    progressDone = 0;
+    progressTotal = total;
+    cancelled = false;
+}
+
+bool HuffmanCoding::reportProgress(uint64_t bytes) {
+    progressDone += bytes;
+    if (progress && !progress(progressDone, progressTotal))
+        cancelled = true;
+    return !cancelled;
+}
+
+bool HuffmanCoding::runBlocks(size_t count, bool inOrder, const function<bool(size_t)>& task) {
+    if (threadCount == 1 || count == 1 || inOrder) {
+        bool ok = true;
+        for (size_t i = 0; i < count; ++i)
+            ok = task(i) && ok;
+        return ok;
+    }
+    // The pool is started by the first batch with more than one block and kept for later calls
+    if (!pool)
+        pool.reset(new ThreadPool(threadCount));
+    vector<future<bool>> results;
+    for (size_t i = 0; i < count; ++i)
+        results.push_back(pool->submit([&task, i] { return task(i); }));
+    bool ok = true;
+    for (future<bool>& result : results)
+        ok = result.get() && ok;
+    return ok;
+}
+
+bool HuffmanCoding::pipeBlocks(bool inOrder, const function<bool(size_t)>& next, const function<bool(size_t)>& work, const function<bool(size_t)>& finish) {
+    if (threadCount == 1 || inOrder) {
+        while (next(0)) {
+            if (!work(0) || !finish(0))
+                return false;
+        }
+        return true;
+    }
+    // The calling thread reads and writes while the pool codes up to two blocks per worker, so
+    // one slow block holds back only the output behind it, not the workers
+    if (!pool)
+        pool.reset(new ThreadPool(threadCount));
+    const size_t slots = 2 * size_t(threadCount);
+    vector<future<bool>> pending(slots);
+    size_t oldest = 0, inFlight = 0;
+    bool ok = true, more = true;
+    // Tasks refer to the callers' buffers, so none may outlive this call
+    auto drain = [&] {
+        for (; inFlight > 0; --inFlight, oldest = (oldest + 1) % slots) {
+            if (pending[oldest].valid())
+                pending[oldest].wait();
+        }
+    };
+    try {
+        while (ok && (more || inFlight > 0)) {
+            if (more && inFlight < slots) {
+                size_t slot = (oldest + inFlight) % slots;
+                more = next(slot);
+                if (more) {
+                    pending[slot] = pool->submit([&work, slot] { return work(slot); });
+                    ++inFlight;
+                }
+                continue;
             }
+            ok = pending[oldest].get();
+            ok = ok && finish(oldest);
+            oldest = (oldest + 1) % slots;
+            --inFlight;
         }
+    } catch (...) {
+        drain();
+        throw;
     }
-    inFile.close();
+    drain();
+    return ok;
+}
+
+bool HuffmanCoding::writeFrame(const vector<unsigned char>& frame, size_t rawSize, ostream& out) {
+    out.write(reinterpret_cast<const char*>(frame.data()), frame.size());
+    seekIndex.push_back(IndexEntry{rawWritten, bytesWritten});
+    rawWritten += rawSize;
+    bytesWritten += frame.size();
+    return reportProgress(rawSize) && static_cast<bool>(out);
+}
+
+bool HuffmanCoding::compressStream(istream& in, ostream& out) {
+    if (mode == Mode::Adaptive)
+        return compressAdaptive(in, out);
+
+    // At most two blocks per thread are in flight, so memory stays bounded by 2 * threadCount * blockSize
+    const size_t slots = 2 * size_t(threadCount);
+    vector<vector<unsigned char>> buffers(slots);
+    vector<vector<unsigned char>> frames(slots);
+    vector<size_t> sizes(slots);
+    startProgress(0);
+    if (!startStream(out))
+        return false;
+
+    bool done = false;
+    auto next = [&](size_t slot) {
+        if (done)
+            return false;
+        buffers[slot].resize(blockSize);
+        in.read(reinterpret_cast<char*>(buffers[slot].data()), blockSize);
+        sizes[slot] = static_cast<size_t>(in.gcount());
+        done = sizes[slot] < blockSize;
+        return sizes[slot] > 0;
+    };
+    auto work = [&](size_t slot) {
+        encodeBlock(buffers[slot].data(), sizes[slot], frames[slot]);
+        return true;
+    };
+    auto finish = [&](size_t slot) { return writeFrame(frames[slot], sizes[slot], out); };
+    if (!pipeBlocks(false, next, work, finish) || in.bad())
+        return false;
+    return finishStream(out);
+}
+
+bool HuffmanCoding::startStream(ostream& out) {
+    out.write(STREAM_MAGIC, 4);
+    out.put(static_cast<char>(FORMAT_VERSION));
+    seekIndex.clear();
+    rawWritten = 0;
+    bytesWritten = STREAM_HEADER_SIZE;
+    return static_cast<bool>(out);
+}
+
+bool HuffmanCoding::finishStream(ostream& out) {
+    // The original size lets the decoder tell a complete stream from one cut at a frame boundary
+    vector<unsigned char> end(1, static_cast<unsigned char>(BLOCK_END));
+    appendU64(end, rawWritten);
+    out.write(reinterpret_cast<const char*>(end.data()), end.size());
+    // Adaptive frames depend on every frame before them, an index could not skip any. A single
+    // block is found by scanning its one frame, so small payloads carry no index
+    if (writeIndex && mode != Mode::Adaptive && seekIndex.size() > 1) {
+        vector<unsigned char> trailer;
+        trailer.reserve(seekIndex.size() * INDEX_ENTRY_SIZE + 8);
+        for (const IndexEntry& entry : seekIndex) {
+            appendU64(trailer, entry.rawOffset);
+            appendU64(trailer, entry.frameOffset);
+        }
+        appendU32(trailer, static_cast<uint32_t>(seekIndex.size()));
+        trailer.insert(trailer.end(), INDEX_MAGIC, INDEX_MAGIC + 4);
+        out.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+    }
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+bool HuffmanCoding::readSeekIndex(const unsigned char* data, size_t size, vector<IndexEntry>& index) {
+    // A stream without an index ends with the high half of its original size, which would
+    // need an input of exabytes to match the magic
+    const size_t minSize = STREAM_HEADER_SIZE + END_RECORD_SIZE + 8;
+    if (size < minSize || memcmp(data + size - 4, INDEX_MAGIC, 4) != 0)
+        return false;
+    size_t pos = size - 8;
+    uint32_t count;
+    readU32(data, size, pos, count);
+    if (count > (size - minSize) / INDEX_ENTRY_SIZE)
+        return false;
+    pos = size - 8 - size_t(count) * INDEX_ENTRY_SIZE;
+    const size_t streamEnd = pos - END_RECORD_SIZE;
+    index.resize(count);
+    for (IndexEntry& entry : index) {
+        readU64(data, size, pos, entry.rawOffset);
+        readU64(data, size, pos, entry.frameOffset);
+        if (entry.frameOffset < STREAM_HEADER_SIZE || entry.frameOffset >= streamEnd || (&entry != &index[0] && (entry.rawOffset <= (&entry)[-1].rawOffset || entry.frameOffset <= (&entry)[-1].frameOffset)))
+            return false;
+    }
+    return true;
+}
+
+bool HuffmanCoding::scanFrames(const unsigned char* data, size_t size, vector<IndexEntry>& index, bool& sequential) {
+    // Without an index, frame headers are walked without decoding any payload
+    index.clear();
+    sequential = false;
+    uint64_t rawOffset = 0;
+    size_t pos = STREAM_HEADER_SIZE;
+    while (pos < size && data[pos] != BLOCK_END) {
+        IndexEntry entry{rawOffset, pos};
+        Frame frame;
+        if (!parseFrame(data, size, pos, frame))
+            return false;
+        index.push_back(entry);
+        rawOffset += frame.rawSize;
+        sequential = sequential || frame.type == BLOCK_ADAPTIVE;
+    }
+    return size - pos >= END_RECORD_SIZE;
+}
+
+bool HuffmanCoding::compressAdaptive(istream& in, ostream& out) {
+    // A frame is cut from whatever input is available and flushed at once, so output
+    // never waits for a full block. Memory is the model plus one block.
+    streambuf* source = in.rdbuf();
+    vector<unsigned char> buffer(blockSize);
+    vector<unsigned char> frame;
+    startProgress(0);
+    if (!startStream(out))
+        return false;
+    adaptiveEncoder.reset();
+
+    while (source->sgetc() != char_traits<char>::eof()) {
+        streamsize available = min<streamsize>(max<streamsize>(source->in_avail(), 1), blockSize);
+        size_t size = static_cast<size_t>(source->sgetn(reinterpret_cast<char*>(buffer.data()), available));
+        frame.clear();
+        encodeBlock(buffer.data(), size, frame);
+        out.write(reinterpret_cast<const char*>(frame.data()), frame.size());
+        out.flush();
+        rawWritten += size;
+        if (!out || !reportProgress(size))
+            return false;
+    }
+    return finishStream(out);
+}
+
+bool HuffmanCoding::compressBuffer(const unsigned char* data, size_t size, ostream& out) {
+    // Blocks are encoded straight out of the caller's memory, nothing is copied
+    const size_t slots = 2 * size_t(threadCount);
+    vector<vector<unsigned char>> frames(slots);
+    vector<ByteSpan> blocks(slots);
+    startProgress(size);
+    if (!startStream(out))
+        return false;
+    adaptiveEncoder.reset();
+
+    size_t pos = 0;
+    auto next = [&](size_t slot) {
+        if (pos >= size)
+            return false;
+        size_t length = min(blockSize, size - pos);
+        blocks[slot] = ByteSpan{data + pos, length};
+        pos += length;
+        return true;
+    };
+    auto work = [&](size_t slot) {
+        encodeBlock(blocks[slot].data, blocks[slot].size, frames[slot]);
+        return true;
+    };
+    auto finish = [&](size_t slot) { return writeFrame(frames[slot], blocks[slot].size, out); };
+    // Adaptive blocks continue each other's model and are coded one after the other
+    if (!pipeBlocks(mode == Mode::Adaptive, next, work, finish))
+        return false;
+    return finishStream(out);
+}
+
+bool HuffmanCoding::decompressStream(istream& in, ostream& out, DecoderType decoder) {
+    // Frame headers carry both sizes, so blocks are carved out of the stream without decoding
+    const size_t slots = 2 * size_t(threadCount);
+    vector<vector<unsigned char>> buffers(slots);
+    vector<vector<unsigned char>> blocks(slots);
+    vector<Frame> frames(slots);
+    startProgress(0);
+    adaptiveDecoder.reset();
+
+    unsigned char header[STREAM_HEADER_SIZE];
+    if (!in.read(reinterpret_cast<char*>(header), STREAM_HEADER_SIZE) || !checkStreamHeader(header))
+        return false;
+
+    uint64_t rawTotal = 0;
+    bool ended = false;
+    auto next = [&](size_t slot) {
+        char type;
+        if (!in.get(type))
+            return false; // The stream ended without an end-of-stream marker
+        if (type == BLOCK_END) {
+            ended = true;
+            return false;
+        }
+        uint32_t rawSize, payloadSize, checksum;
+        if (!readU32(in, rawSize) || !readU32(in, payloadSize) || !readU32(in, checksum) || !checkFrameSizes(type, rawSize, payloadSize))
+            return false;
+        // The buffer grows with the bytes that actually arrive, so a truncated stream fails at its end
+        // without first allocating the size its header claims
+        vector<unsigned char>& buffer = buffers[slot];
+        for (size_t got = 0; got < payloadSize;) {
+            size_t step = min<size_t>(payloadSize - got, max<size_t>(got, READ_STEP));
+            buffer.resize(got + step);
+            if (!in.read(reinterpret_cast<char*>(buffer.data() + got), step))
+                return false;
+            got += step;
+        }
+        frames[slot] = Frame{type, rawSize, ByteSpan{buffer.data(), payloadSize}, checksum};
+        rawTotal += rawSize;
+        return true;
+    };
+    // Adaptive frames are decoded and flushed as soon as each one arrives
+    const bool adaptive = in.peek() == BLOCK_ADAPTIVE;
+    auto work = [&](size_t slot) { return (adaptive || frames[slot].type != BLOCK_ADAPTIVE) && decodeFrame(frames[slot], blocks[slot], decoder); };
+    auto finish = [&](size_t slot) {
+        out.write(reinterpret_cast<const char*>(blocks[slot].data()), blocks[slot].size());
+        out.flush();
+        return reportProgress(FRAME_HEADER_SIZE + frames[slot].payload.size) && static_cast<bool>(out);
+    };
+    if (!pipeBlocks(adaptive, next, work, finish) || !ended)
+        return false;
+    uint64_t originalSize;
+    return readU64(in, originalSize) && originalSize == rawTotal;
+}
+
+bool HuffmanCoding::decompressBuffer(const unsigned char* data, size_t size, ostream& out, DecoderType decoder) {
+    // Frames are decoded straight out of the caller's memory, only the decoded blocks are buffered
+    const size_t slots = 2 * size_t(threadCount);
+    vector<vector<unsigned char>> blocks(slots);
+    vector<Frame> frames(slots);
+    startProgress(size);
+    adaptiveDecoder.reset();
+    if (size < STREAM_HEADER_SIZE || !checkStreamHeader(data))
+        return false;
+
+    size_t pos = STREAM_HEADER_SIZE;
+    uint64_t rawTotal = 0;
+    bool ended = false;
+    auto next = [&](size_t slot) {
+        if (pos >= size)
+            return false; // The stream ended without an end-of-stream marker
+        if (data[pos] == BLOCK_END) {
+            ended = true;
+            return false;
+        }
+        if (!parseFrame(data, size, pos, frames[slot]))
+            return false;
+        rawTotal += frames[slot].rawSize;
+        return true;
+    };
+    // Adaptive frames share one model and are decoded in order, a stream of other frames may not contain any
+    const bool adaptive = pos < size && data[pos] == BLOCK_ADAPTIVE;
+    auto work = [&](size_t slot) { return (adaptive || frames[slot].type != BLOCK_ADAPTIVE) && decodeFrame(frames[slot], blocks[slot], decoder); };
+    auto finish = [&](size_t slot) {
+        out.write(reinterpret_cast<const char*>(blocks[slot].data()), blocks[slot].size());
+        return reportProgress(FRAME_HEADER_SIZE + frames[slot].payload.size) && static_cast<bool>(out);
+    };
+    if (!pipeBlocks(adaptive, next, work, finish) || !ended)
+        return false;
+    uint64_t originalSize;
+    ++pos;
+    return readU64(data, size, pos, originalSize) && originalSize == rawTotal;
+}
+
+void HuffmanCoding::trainTable(const uint8_t* data, size_t size) {
+    // Sample counts are scaled down to keep tree frequencies in range, and every byte value keeps
+    // a nonzero count so data outside the sample still has a code
+    uint64_t totals[256] = {0};
+    for (size_t pos = 0; pos < size; pos += MAX_BLOCK_SIZE) {
+        Histogram freq;
+        countSymbols(data + pos, min(MAX_BLOCK_SIZE, size - pos), freq);
+        for (int symbol = 0; symbol < 256; ++symbol)
+            totals[symbol] += freq[symbol];
+    }
+    int shift = 0;
+    while ((size >> shift) > (uint64_t(1) << 24))
+        ++shift;
+    Histogram freq;
+    for (int symbol = 0; symbol < 256; ++symbol)
+        freq[symbol] = static_cast<uint32_t>(totals[symbol] >> shift) + 1;
+
+    vector<HuffmanCode> huffmanCodes;
+    buildHuffmanCodes(freq.data(), huffmanCodes);
+    setSharedTable(huffmanCodes);
+}
+
+bool HuffmanCoding::saveTable(const string& tableFile) const {
+    // Nothing to save before a table has been trained or loaded
+    if (sharedCodes.empty())
+        return false;
+    ofstream outFile(tableFile, ios::binary);
+    if (!outFile)
+        return false;
+    vector<unsigned char> lengths;
+    writeCodeLengths(sharedCodes, lengths);
+    outFile.write(TABLE_MAGIC, 4);
+    outFile.write(reinterpret_cast<const char*>(lengths.data()), lengths.size());
+    return static_cast<bool>(outFile);
+}
+
+bool HuffmanCoding::loadTable(const string& tableFile) {
+    ifstream inFile(tableFile, ios::binary);
+    if (!inFile)
+        return false;
+    vector<unsigned char> bytes((istreambuf_iterator<char>(inFile)), istreambuf_iterator<char>());
+    vector<HuffmanCode> huffmanCodes;
+    size_t pos = 4;
+    if (bytes.size() < 4 || memcmp(bytes.data(), TABLE_MAGIC, 4) != 0 || !readCodeLengths(bytes.data(), bytes.size(), pos, huffmanCodes) || !assignCanonicalCodes(huffmanCodes))
+        return false;
+    for (const HuffmanCode& code : huffmanCodes) {
+        if (code.length == 0)
+            return false;
+    }
+    setSharedTable(huffmanCodes);
+    return true;
+}
+
+void HuffmanCoding::clearTable() {
+    sharedCodes.clear();
+    sharedDecodeTable.clear();
+    sharedTableId = 0;
+}
+
+void HuffmanCoding::setSharedTable(const vector<HuffmanCode>& huffmanCodes) {
+    sharedCodes = huffmanCodes;
+    buildDecodeTable(sharedCodes, sharedDecodeTable);
+    // FNV-1a over the code lengths identifies the table in every block written with it
+    sharedTableId = 2166136261u;
+    for (const HuffmanCode& code : sharedCodes)
+        sharedTableId = (sharedTableId ^ code.length) * 16777619u;
+}
+
+streamsize MemorySink::xsputn(const char* s, streamsize n) {
+    if (vec) {
+        vec->insert(vec->end(), s, s + n);
+        return n;
+    }
+    if (static_cast<size_t>(n) > capacity - used) {
+        full = true;
+        return 0;
+    }
+    memcpy(dst + used, s, n);
+    used += n;
+    return n;
+}
+
+MemorySink::int_type MemorySink::overflow(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+        return traits_type::not_eof(ch);
+    char c = traits_type::to_char_type(ch);
+    return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+}
+
+size_t HuffmanCoding::compressBound(size_t size) const {
+    // Frames other than adaptive ones are never larger than a stored frame. Add the stream header,
+    // the end record and the index trailer
+    size_t blocks = (size + blockSize - 1) / blockSize;
+    if (mode == Mode::Adaptive) {
+        // Halving at MAX_WEIGHT keeps adaptive codes within 24 bits, first occurrences add an 8-bit literal
+        return size * 3 + 256 * 4 + blocks * (FRAME_HEADER_SIZE + 1) + STREAM_HEADER_SIZE + END_RECORD_SIZE;
+    }
+    return size + blocks * (FRAME_HEADER_SIZE + INDEX_ENTRY_SIZE) + STREAM_HEADER_SIZE + END_RECORD_SIZE + 8;
+}
+
+HuffmanCoding::Status HuffmanCoding::compress(const uint8_t* data, size_t size, vector<uint8_t>& out) {
+    out.clear();
+    out.reserve(size / 2 + 512);
+    MemorySink sink(out);
+    ostream stream(&sink);
+    return compressBuffer(data, size, stream) ? Status::Ok : Status::Cancelled;
+}
+
+HuffmanCoding::Status HuffmanCoding::compress(const uint8_t* data, size_t size, uint8_t* dst, size_t capacity, size_t& written) {
+    MemorySink sink(dst, capacity);
+    ostream stream(&sink);
+    bool ok = compressBuffer(data, size, stream);
+    written = sink.size();
+    if (sink.overflowed())
+        return Status::OutputTooSmall;
+    return ok ? Status::Ok : Status::Cancelled;
+}
+
+HuffmanCoding::Status HuffmanCoding::decompress(const uint8_t* data, size_t size, vector<uint8_t>& out, DecoderType decoder) {
+    out.clear();
+    MemorySink sink(out);
+    ostream stream(&sink);
+    try {
+        if (decompressBuffer(data, size, stream, decoder))
+            return Status::Ok;
+    } catch (const bad_alloc&) {
+        return Status::CorruptData;
+    }
+    return cancelled ? Status::Cancelled : Status::CorruptData;
+}
+
+HuffmanCoding::Status HuffmanCoding::decompress(const uint8_t* data, size_t size, uint8_t* dst, size_t capacity, size_t& written, DecoderType decoder) {
+    MemorySink sink(dst, capacity);
+    ostream stream(&sink);
+    bool ok;
+    try {
+        ok = decompressBuffer(data, size, stream, decoder);
+    } catch (const bad_alloc&) {
+        written = sink.size();
+        return Status::CorruptData;
+    }
+    written = sink.size();
+    if (sink.overflowed())
+        return Status::OutputTooSmall;
+    if (!ok)
+        return cancelled ? Status::Cancelled : Status::CorruptData;
+    return Status::Ok;
+}
+
+const string& HuffmanCoding::lastError() const {
+    return errorMessage;
+}
+
+bool HuffmanCoding::fail(const string& message) {
+    errorMessage = message;
+    cerr << message << endl;
+    return false;
+}
+
+bool HuffmanCoding::compressFile(const string& inputFile, const string& outputFile) {
+    errorMessage.clear();
+    MappedFile mapping(inputFile);
+    ifstream inFile;
+    if (!mapping.isOpen()) {
+        inFile.open(inputFile, ios::binary);
+        if (!inFile)
+            return fail("Error opening input file: " + inputFile);
+    }
+    vector<char> outBuffer(OUTPUT_BUFFER_SIZE);
+    ofstream outFile;
+    outFile.rdbuf()->pubsetbuf(outBuffer.data(), outBuffer.size());
+    outFile.open(outputFile, ios::binary);
+    if (!outFile)
+        return fail("Error opening output file: " + outputFile);
+    bool ok = mapping.isOpen() ? compressBuffer(mapping.data(), mapping.size(), outFile) : compressStream(inFile, outFile);
+    if (!ok)
+        return cancelled ? false : fail("Error compressing file: " + inputFile);
     outFile.close();
-    cout<<"File decompressed successfully!"<<endl;
-}
\ No newline at end of file
+    if (!outFile)
+        return fail("Error writing output file: " + outputFile);
+    return true;
+}
+
+bool HuffmanCoding::decompressFile(const string& inputFile, const string& outputFile, DecoderType decoder) {
+    errorMessage.clear();
+    MappedFile mapping(inputFile);
+    ifstream inFile;
+    if (!mapping.isOpen()) {
+        inFile.open(inputFile, ios::binary);
+        if (!inFile)
+            return fail("Error opening input file: " + inputFile);
+    }
+    vector<char> outBuffer(OUTPUT_BUFFER_SIZE);
+    ofstream outFile;
+    outFile.rdbuf()->pubsetbuf(outBuffer.data(), outBuffer.size());
+    outFile.open(outputFile, ios::binary);
+    if (!outFile)
+        return fail("Error opening output file: " + outputFile);
+    bool ok = mapping.isOpen() ? decompressBuffer(mapping.data(), mapping.size(), outFile, decoder) : decompressStream(inFile, outFile, decoder);
+    if (!ok)
+        return cancelled ? false : fail("Error decompressing file: " + inputFile);
+    outFile.close();
+    if (!outFile)
+        return fail("Error writing output file: " + outputFile);
+    return true;
+}
+
+bool HuffmanCoding::decompressRange(const string& inputFile, uint64_t offset, size_t length, vector<uint8_t>& out, DecoderType decoder) {
+    out.clear();
+    errorMessage.clear();
+    MappedFile mapping(inputFile);
+    vector<unsigned char> contents;
+    const unsigned char* data = mapping.data();
+    size_t size = mapping.size();
+    if (!mapping.isOpen()) {
+        ifstream inFile(inputFile, ios::binary);
+        if (!inFile)
+            return fail("Error opening input file: " + inputFile);
+        contents.assign(istreambuf_iterator<char>(inFile), istreambuf_iterator<char>());
+        data = contents.data();
+        size = contents.size();
+    }
+
+    vector<IndexEntry> index;
+    bool sequential = false;
+    if (size < STREAM_HEADER_SIZE || !checkStreamHeader(data) || (!readSeekIndex(data, size, index) && !scanFrames(data, size, index, sequential)))
+        return fail("Error decompressing file: " + inputFile);
+
+    if (length == 0 || index.empty())
+        return true;
+    length = static_cast<size_t>(min<uint64_t>(length, UINT64_MAX - offset));
+
+    // Blocks overlapping the range, adaptive streams have to be decoded from their first block
+    auto startsAfter = [](uint64_t value, const IndexEntry& entry) { return value < entry.rawOffset; };
+    size_t first = upper_bound(index.begin(), index.end(), offset, startsAfter) - index.begin() - 1;
+    size_t last = upper_bound(index.begin(), index.end(), offset + length - 1, startsAfter) - index.begin();
+    if (sequential)
+        first = 0;
+
+    vector<Frame> frames;
+    for (size_t i = first; i < last; ++i) {
+        size_t pos = index[i].frameOffset;
+        Frame frame;
+        if (!parseFrame(data, size, pos, frame) || (i + 1 < index.size() && index[i].rawOffset + frame.rawSize != index[i + 1].rawOffset))
+            return fail("Error decompressing file: " + inputFile);
+        frames.push_back(frame);
+    }
+
+    adaptiveDecoder.reset();
+    vector<vector<unsigned char>> blocks(frames.size());
+    bool ok = runBlocks(frames.size(), sequential, [&](size_t i) { return decodeFrame(frames[i], blocks[i], decoder); });
+    if (!ok)
+        return fail("Error decompressing file: " + inputFile);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        uint64_t blockStart = index[first + i].rawOffset;
+        uint64_t from = max(offset, blockStart) - blockStart;
+        uint64_t to = min<uint64_t>(offset + length - blockStart, blocks[i].size());
+        if (from < to)
+            out.insert(out.end(), blocks[i].begin() + from, blocks[i].begin() + to);
+    }
+    return true;
+}
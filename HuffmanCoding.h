@@ -3,39 +3,344 @@
 #include <cstdlib>
 #include <iostream>
 #include <vector>
-#include <unordered_map>
 #include <fstream>
 #include <bitset>
 #include <queue>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <functional>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+#include "AdaptiveModel.h"
+#include "BitStream.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
 using namespace std;
 
-// Huffman tree node 
-struct MinHeapNode {
-    char data; // One of the input characters 
-    unsigned freq; // Frequency of the character 
-    MinHeapNode* left , * right; // Left and right child of this node 
-    MinHeapNode(char data, unsigned freq) : data(data), freq(freq), left(nullptr), right(nullptr) {}
+// Huffman tree node, children are indices into the node array of the owning tree
+template <typename Symbol, typename Index>
+struct BasicHeapNode {
+    static constexpr Index NO_CHILD = numeric_limits<Index>::max(); // Child index of a leaf
+
+    Symbol data; // Symbol of a leaf
+    unsigned freq; // Frequency of the symbol, or of all symbols below an internal node
+    Index left, right; // Left and right child of this node
+    BasicHeapNode(Symbol data, unsigned freq, Index left = NO_CHILD, Index right = NO_CHILD) : data(data), freq(freq), left(left), right(right) {}
+    bool isLeaf() const { return left == NO_CHILD && right == NO_CHILD; }
+};
+
+// Huffman tree held in one contiguous node array, released together with the tree
+template <typename Symbol, typename Index>
+struct BasicHuffmanTree {
+    using Node = BasicHeapNode<Symbol, Index>;
+
+    vector<Node> nodes; // All nodes of the tree
+    Index root = Node::NO_CHILD; // Index of the root node
+
+    Index addNode(Symbol data, unsigned freq, Index left = Node::NO_CHILD, Index right = Node::NO_CHILD) {
+        nodes.emplace_back(data, freq, left, right);
+        return static_cast<Index>(nodes.size() - 1);
+    }
+};
+
+// Symbol alphabet a coder is compiled for. Trees, code tables and decode tables are sized
+// from it, and node indices stay 16-bit while the tree fits.
+template <typename Symbol, size_t Size, int MaxCodeLength, int PrimaryTableBits>
+struct Alphabet {
+    using SymbolType = Symbol;
+    using NodeIndex = typename conditional<(2 * Size < 0xFFFF), uint16_t, uint32_t>::type;
+    using Tree = BasicHuffmanTree<Symbol, NodeIndex>;
+
+    static constexpr size_t SIZE = Size; // Number of symbol values
+    static constexpr int MAX_CODE_LENGTH = MaxCodeLength; // Longest code, lengths are limited to fit the decode table
+    static constexpr int PRIMARY_TABLE_BITS = PrimaryTableBits; // Index width of the primary decode table
+};
+
+using ByteAlphabet = Alphabet<unsigned char, 256, 15, 11>; // Bytes, the alphabet of all byte-oriented frames
+using WideAlphabet = Alphabet<uint16_t, 65536, 20, 12>; // 16-bit values and dictionary token ids
+using LiteralAlphabet = Alphabet<uint16_t, 288, 15, 11>; // Bytes and match length buckets of LZ frames
+using DistanceAlphabet = Alphabet<uint8_t, 48, 15, 9>; // Match distance buckets of LZ frames
+using MtfAlphabet = Alphabet<uint16_t, 257, 15, 11>; // Zero-run digits and move-to-front ranks of BWT frames
+using MinHeapNode = BasicHeapNode<unsigned char, uint16_t>;
+using HuffmanTree = ByteAlphabet::Tree;
+
+// Output stream buffer writing into memory, either a growing vector or a fixed
+// caller buffer that refuses to write past its capacity
+class MemorySink : public streambuf {
+public:
+    explicit MemorySink(vector<uint8_t>& out) : vec(&out) {}
+    MemorySink(uint8_t* dst, size_t capacity) : dst(dst), capacity(capacity) {}
+
+    size_t size() const { return vec ? vec->size() : used; }
+    bool overflowed() const { return full; }
+
+protected:
+    streamsize xsputn(const char* s, streamsize n) override;
+    int_type overflow(int_type ch) override;
+
+private:
+    vector<uint8_t>* vec = nullptr; // Growing output, null when writing to a fixed buffer
+    uint8_t* dst = nullptr; // Fixed output buffer
+    size_t capacity = 0; // Size of the fixed output buffer
+    size_t used = 0; // Bytes written to the fixed output buffer
+    bool full = false; // A write did not fit into the fixed output buffer
 };
 
 // Huffman Coding class
 class HuffmanCoding {
 public:
-    void compressFile(const string& inputFile, const string& outputFile);
-    void decompressFile(const string& inputFile, const string& outputFile);
+    // Result of the in-memory API
+    enum class Status {
+        Ok,
+        OutputTooSmall, // The caller's buffer cannot hold the result
+        CorruptData, // The compressed data is truncated, malformed or fails its checksum
+        Cancelled // The progress callback cancelled the job, the output is incomplete
+    };
+
+    // Decoder used by decompressFile
+    enum class DecoderType {
+        TreeWalk, // Walk the Huffman tree one bit at a time
+        Table     // Resolve whole symbols with a multi-bit lookup table
+    };
+
+    // Coding used by the compressor, the decompressor follows whatever the frames say
+    enum class Mode {
+        Static,  // Codes built from the histogram of each block and stored with it
+        Adaptive, // Codes updated symbol by symbol (FGK), one pass and no stored table
+        Context, // Order-1: the previous byte picks one of up to 16 clustered code tables
+        Wide, // 16-bit little-endian symbols, for columns of integers and other 16-bit data
+        Words, // Word and punctuation tokens numbered through a dictionary stored with each block
+        Lz, // LZ77 matches within the block, literals and lengths share one code table and distances have another
+        Bwt // Burrows-Wheeler transform of the block, then move-to-front ranks with zero runs, as bzip2 does
+    };
+
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 20; // Input bytes per block
+    static constexpr size_t DEFAULT_WINDOW_SIZE = 1 << 18; // Distance an LZ match may reach back
+    static constexpr size_t MAX_WINDOW_SIZE = 1 << 24; // Longest distance the distance codes cover
+    static constexpr size_t MAX_BLOCK_SIZE = 1 << 30; // Largest block a stream may declare
+    static constexpr size_t OUTPUT_BUFFER_SIZE = 4 << 20; // Write buffer of the output file
+
+    // File API, errors are reported on cerr and kept for lastError(), and the result tells whether
+    // the output is complete
+    const string& lastError() const; // Why the last file operation failed, empty after success or cancellation
+    bool compressFile(const string& inputFile, const string& outputFile);
+    bool decompressFile(const string& inputFile, const string& outputFile, DecoderType decoder = DecoderType::Table);
+    // Decode only the blocks overlapping [offset, offset + length) of the original data, the
+    // range is clipped at its end. Uses the seek index, or the frame headers without one.
+    bool decompressRange(const string& inputFile, uint64_t offset, size_t length, vector<uint8_t>& out, DecoderType decoder = DecoderType::Table);
+    // Single-pass compression of any stream (pipes, stdin), memory is bounded by the block size
+    bool compressStream(istream& in, ostream& out);
+    bool decompressStream(istream& in, ostream& out, DecoderType decoder = DecoderType::Table);
+    // Same formats, encoded from or decoded out of memory without copying the input
+    bool compressBuffer(const unsigned char* data, size_t size, ostream& out);
+    bool decompressBuffer(const unsigned char* data, size_t size, ostream& out, DecoderType decoder = DecoderType::Table);
+    void setBlockSize(size_t size);
+    // In adaptive mode compressStream emits a frame for whatever input is available and
+    // flushes it, so output keeps up with slow producers such as telemetry pipes
+    void setMode(Mode mode);
+    // Split each order-0 block into four streams that the table decoder reads side by side,
+    // which overlaps their dependency chains on out-of-order CPUs for 12 more header bytes
+    void setInterleaved(bool enabled);
+    // Window of the LZ match finder, clipped to MAX_WINDOW_SIZE. Matches never cross a block
+    // boundary, so blocks stay independent, and a larger window only helps larger blocks.
+    void setWindowSize(size_t size);
+    // Block index written after the end marker, so decompressRange can find blocks without
+    // decoding. On by default for streams of more than one block, turning it off saves 16 bytes
+    // per block and 8 per stream.
+    void setSeekIndex(bool enabled);
+    // Number of threads encoding or decoding blocks in parallel
+    void setThreadCount(unsigned threads);
+
+    // Called on the calling thread after each block is written, with the input bytes
+    // consumed so far and the input size (0 when unknown). Returning false cancels the job.
+    using ProgressCallback = function<bool(uint64_t done, uint64_t total)>;
+    void setProgressCallback(ProgressCallback callback);
+
+    // Shared code table trained on sample data. While one is loaded, blocks are
+    // written without their own code table, and decompression needs the same table.
+    void trainTable(const uint8_t* data, size_t size);
+    bool saveTable(const string& tableFile) const;
+    bool loadTable(const string& tableFile);
+    void clearTable();
+
+    // In-memory API, nothing is printed and no temporary files are used
+    size_t compressBound(size_t size) const; // Largest compressed size of size input bytes
+    Status compress(const uint8_t* data, size_t size, vector<uint8_t>& out);
+    Status compress(const uint8_t* data, size_t size, uint8_t* dst, size_t capacity, size_t& written);
+    Status decompress(const uint8_t* data, size_t size, vector<uint8_t>& out, DecoderType decoder = DecoderType::Table);
+    Status decompress(const uint8_t* data, size_t size, uint8_t* dst, size_t capacity, size_t& written, DecoderType decoder = DecoderType::Table);
 
 private:
-    struct MinHeap {
-        vector<MinHeapNode*> array; // Array of minheap node pointers
-    };
-
-    MinHeapNode* buildHuffmanTree(const unordered_map<char, unsigned>& freqmap);
-    void generateHuffmanCodes(MinHeapNode* root, string code, unordered_map<char, string>& huffmanCodes);
-    MinHeap* createAndBuildMinHeap(const unordered_map<char, unsigned>& freqmap);
-    void minHeapify(MinHeap* minHeap, int idx);
-    MinHeapNode* extractMin(MinHeap* minHeap);
-    void insertMinHeap(MinHeap* minHeap, MinHeapNode* minHeapNode);
-    void buildMinHeap(MinHeap* minHeap);
-    void swapMinHeapNode(MinHeapNode** a, MinHeapNode** b);
+    // Frame types of the block stream
+    enum BlockType : char {
+        BLOCK_END = 0, // End of stream
+        BLOCK_HUFFMAN = 1, // Code lengths followed by the encoded block
+        BLOCK_SHARED = 2, // Id of the shared table followed by the encoded block
+        BLOCK_ADAPTIVE = 3, // Adaptive codes, continuing the model of the previous adaptive frame
+        BLOCK_CONTEXT = 4, // Table count, context to table map, code lengths of each table, encoded block
+        BLOCK_HUFFMAN4 = 5, // Code lengths, sizes of streams 1-3, then four streams each coding a quarter of the block
+        BLOCK_WIDE = 6, // Code lengths of 16-bit symbols, the odd last byte if any, then the encoded symbols
+        BLOCK_WORDS = 7, // Token count, byte-coded dictionary, code lengths of the token ids, then the encoded ids
+        BLOCK_LZ = 8, // Code lengths of literals and lengths, code lengths of distances, then literals and matches
+        BLOCK_BWT = 9, // Rows of the whole block and of its quarters among the sorted rotations, code lengths, ranks and zero runs
+        BLOCK_STORED = 10, // The block as is, for data coding would not shrink
+        BLOCK_RUN = 11 // The one byte value the block consists of
+    };
+
+    static constexpr const char* STREAM_MAGIC = "HUFC"; // First bytes of a compressed stream
+    static constexpr uint8_t FORMAT_VERSION = 1; // Follows the magic, bumped on incompatible format changes
+    static constexpr size_t STREAM_HEADER_SIZE = 5; // Magic and version
+    static constexpr size_t FRAME_HEADER_SIZE = 13; // Type, raw size, payload size and CRC32C of the raw block
+    static constexpr size_t END_RECORD_SIZE = 9; // End marker and 64-bit original size
+    static constexpr size_t READ_STEP = 1 << 20; // Smallest step a streamed frame payload grows by
+    static constexpr const char* TABLE_MAGIC = "HUFT"; // First bytes of a saved shared table
+    static constexpr const char* INDEX_MAGIC = "HIDX"; // Last bytes of a stream with a seek index
+    static constexpr size_t INDEX_ENTRY_SIZE = 16; // Raw offset and frame offset of a block
+
+    size_t blockSize = DEFAULT_BLOCK_SIZE;
+    size_t windowSize = DEFAULT_WINDOW_SIZE;
+    Mode mode = Mode::Static;
+    bool interleaved = false;
+    bool writeIndex = true;
+    unsigned threadCount = max(1u, thread::hardware_concurrency());
+    unique_ptr<ThreadPool> pool; // Workers for parallel blocks, started on first use
+
+    ProgressCallback progress; // Progress observer, may be empty
+    uint64_t progressDone = 0; // Input bytes consumed by the running job
+    uint64_t progressTotal = 0; // Input size of the running job, 0 when unknown
+    bool cancelled = false; // The progress callback cancelled the running job
+    string errorMessage; // Reason the last file operation failed
+
+    static constexpr int PRIMARY_TABLE_BITS = ByteAlphabet::PRIMARY_TABLE_BITS;
+    static constexpr int MAX_CODE_LENGTH = ByteAlphabet::MAX_CODE_LENGTH;
+    static constexpr size_t MIN_WIDE_SIZE = 4096; // Smaller blocks cannot repay the work and table of a 16-bit alphabet
+    static constexpr uint16_t RUN_A = 0; // Zero-run digit worth one times its place value, ranks start at 2
+    static constexpr uint16_t RUN_B = 1; // Zero-run digit worth two times its place value
+    static constexpr size_t MIN_INTERLEAVED_SIZE = 1024; // Smaller blocks are not worth splitting into streams
+
+    // Decode table entry, resolves up to two whole symbols per probe
+    struct DecodeEntry {
+        uint32_t link; // Offset of the linked sub-table (count == 0)
+        unsigned char symbols[2]; // Decoded symbols
+        uint8_t count; // Number of symbols decoded, 0 for a link to a sub-table
+        uint8_t length; // Bits consumed by all symbols, or index width of the linked sub-table
+        uint8_t firstLength; // Bits consumed by the first symbol alone
+    };
+
+    // Decode table entry of a wide alphabet, resolves one symbol per probe
+    template <class A>
+    struct SymbolEntry {
+        uint32_t link; // Offset of the linked sub-table (count == 0)
+        typename A::SymbolType symbol; // Decoded symbol
+        uint8_t count; // 1 for a symbol, 0 for a link to a sub-table
+        uint8_t length; // Bits consumed by the symbol, or index width of the linked sub-table
+    };
+
+    // Contiguous bytes owned by someone else: a read buffer, a mapped file or a caller's memory
+    struct ByteSpan {
+        const unsigned char* data;
+        size_t size;
+    };
+
+    // One frame of the block stream
+    struct Frame {
+        char type; // BlockType of the frame
+        uint32_t rawSize; // Size of the decoded block
+        ByteSpan payload; // Bytes following the frame header
+        uint32_t checksum; // CRC32C of the decoded block
+    };
+
+    // Seek index entry. Frames start on byte boundaries, so a byte offset locates a block exactly.
+    struct IndexEntry {
+        uint64_t rawOffset; // Position of the block in the original data
+        uint64_t frameOffset; // Position of its frame in the compressed stream
+    };
+
+    using Histogram = array<uint32_t, 256>; // Occurrences of each byte value in a block
+
+    // Huffman code of one symbol, stored right aligned
+    struct HuffmanCode {
+        uint64_t bits; // Code bits, most significant bit first
+        uint8_t length; // Number of code bits, 0 if the symbol does not occur
+    };
+
+    AdaptiveModel adaptiveEncoder; // Model of the stream being compressed
+    AdaptiveModel adaptiveDecoder; // Model of the stream being decompressed
+
+    vector<IndexEntry> seekIndex; // Blocks written so far by the running compression
+    uint64_t rawWritten = 0; // Input bytes covered by those blocks
+    uint64_t bytesWritten = 0; // Compressed bytes written for them
+
+    vector<HuffmanCode> sharedCodes; // Codes of the shared table, empty when none is loaded
+    vector<DecodeEntry> sharedDecodeTable; // Decode table of the shared table
+    uint32_t sharedTableId = 0; // Hash of the shared code lengths
+
+    static void countSymbols(const unsigned char* data, size_t size, Histogram& freq);
+    template <class A> static void buildHuffmanTree(const uint32_t* freq, typename A::Tree& tree);
+    template <class A> static void limitCodeLengths(const uint32_t* freq, vector<HuffmanCode>& huffmanCodes);
+    template <class A = ByteAlphabet> static void buildHuffmanCodes(const uint32_t* freq, vector<HuffmanCode>& huffmanCodes);
+    template <class A> static void generateHuffmanCodes(const typename A::Tree& tree, typename A::NodeIndex node, uint64_t bits, int length, vector<HuffmanCode>& huffmanCodes);
+    bool runBlocks(size_t count, bool inOrder, const function<bool(size_t)>& task);
+    // Streams blocks through the pool: next fills a slot on the calling thread and returns false at
+    // the end, work codes it on a worker, and finish writes it on the calling thread in input order
+    bool pipeBlocks(bool inOrder, const function<bool(size_t)>& next, const function<bool(size_t)>& work, const function<bool(size_t)>& finish);
+    bool writeFrame(const vector<unsigned char>& frame, size_t rawSize, ostream& out);
+    void startProgress(uint64_t total);
+    bool fail(const string& message); // Records and prints the error of a file operation, returns false
+    bool reportProgress(uint64_t bytes);
+    static void writeU32(ostream& out, uint32_t value);
+    static bool readU32(istream& in, uint32_t& value);
+    static bool readU32(const unsigned char* data, size_t size, size_t& pos, uint32_t& value);
+    static bool readU64(istream& in, uint64_t& value);
+    static bool readU64(const unsigned char* data, size_t size, size_t& pos, uint64_t& value);
+    template <class A = ByteAlphabet> static bool assignCanonicalCodes(vector<HuffmanCode>& huffmanCodes);
+    template <class A = ByteAlphabet> static void writeCodeLengths(const vector<HuffmanCode>& huffmanCodes, vector<unsigned char>& out);
+    template <class A = ByteAlphabet> static bool readCodeLengths(const unsigned char* data, size_t size, size_t& pos, vector<HuffmanCode>& huffmanCodes);
+    template <class A> static void buildSymbolTable(const vector<HuffmanCode>& huffmanCodes, vector<SymbolEntry<A>>& table);
+    template <class A> static bool decodeSymbol(const SymbolEntry<A>* table, BitReader& reader, typename A::SymbolType& symbol);
+    template <class A, class Store> static bool decodeSymbols(const vector<SymbolEntry<A>>& table, const unsigned char* data, size_t size, size_t count, Store store);
+    static uint64_t entropyFrameSize(const Histogram& freq);
+    static uint64_t fallbackFrameSize(const Histogram& freq);
+    void encodeBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame);
+    void encodeStoredBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame);
+    bool compressAdaptive(istream& in, ostream& out);
+    bool encodeContextBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame);
+    bool encodeWideBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame);
+    bool encodeWordsBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame);
+    bool decodeWideBlock(const unsigned char* payload, size_t payloadSize, unsigned char* out, size_t count);
+    bool decodeWordsBlock(const unsigned char* payload, size_t payloadSize, unsigned char* out, size_t count);
+    static uint32_t readBucket(uint32_t bucket, BitReader& reader);
+    bool encodeLzBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame);
+    bool decodeLzBlock(const unsigned char* payload, size_t payloadSize, unsigned char* out, size_t count);
+    bool encodeBwtBlock(const unsigned char* data, size_t size, vector<unsigned char>& frame);
+    bool decodeBwtBlock(const unsigned char* payload, size_t payloadSize, unsigned char* out, size_t count);
+    static void appendU32(vector<unsigned char>& out, uint32_t value);
+    static void appendU64(vector<unsigned char>& out, uint64_t value);
+    static bool checkStreamHeader(const unsigned char* header);
+    static bool checkFrameSizes(char type, uint32_t rawSize, uint32_t payloadSize);
+    static bool parseFrame(const unsigned char* data, size_t size, size_t& pos, Frame& frame);
+    bool startStream(ostream& out);
+    bool finishStream(ostream& out);
+    static bool readSeekIndex(const unsigned char* data, size_t size, vector<IndexEntry>& index);
+    static bool scanFrames(const unsigned char* data, size_t size, vector<IndexEntry>& index, bool& sequential);
+    static void beginFrame(BlockType type, const unsigned char* data, size_t size, vector<unsigned char>& frame);
+    static void endFrame(vector<unsigned char>& frame);
+    bool decodeFrame(const Frame& frame, vector<unsigned char>& block, DecoderType decoder);
+    bool decodeBlock(const Frame& frame, unsigned char* out, DecoderType decoder);
+    void buildDecodeTree(const vector<HuffmanCode>& huffmanCodes, HuffmanTree& tree);
+    void setSharedTable(const vector<HuffmanCode>& huffmanCodes);
+    void buildDecodeTable(const vector<HuffmanCode>& huffmanCodes, vector<DecodeEntry>& table);
+    bool decodeWithTable(const vector<DecodeEntry>& table, const unsigned char* data, size_t size, unsigned char* out, size_t count);
+    static bool decodeStep(const DecodeEntry* table, BitReader& reader, unsigned char*& out, unsigned char* end);
+    bool decodeInterleaved(const vector<DecodeEntry>& table, const array<ByteSpan, 4>& streams, unsigned char* out, size_t count);
+    bool decodeWithContextTables(const vector<vector<DecodeEntry>>& tables, const array<uint8_t, 256>& clusterOf, const unsigned char* data, size_t size, unsigned char* out, size_t count);
+    bool decodeWithTree(const HuffmanTree& tree, const unsigned char* data, size_t size, unsigned char* out, size_t count);
 };
-#include "HuffmanCoding.cpp" // Include the implementation file for HuffmanCoding class
 #endif // HUFFMAN_CODING_H
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "LzMatcher.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+using namespace std;
+
+namespace {
+
+const int LZ_HASH_BITS = 16; // Index width of the hash chain heads
+const int MAX_CHAIN_LENGTH = 32; // Candidates the match finder compares per position
+
+}
+
+void findMatches(const unsigned char* data, size_t size, size_t windowSize, vector<LzToken>& tokens) {
+    // Hash chains: head holds the latest position of each hash of MIN_MATCH bytes and prev links every
+    // position to the previous one with the same hash. Matches are taken greedily.
+    const uint32_t NONE = numeric_limits<uint32_t>::max();
+    const size_t window = min(windowSize, size);
+    size_t chainSize = 1;
+    while (chainSize < window)
+        chainSize <<= 1;
+    const size_t mask = chainSize - 1;
+    // Small blocks get a smaller hash table, clearing it would otherwise cost more than matching
+    int hashBits = LZ_HASH_BITS;
+    while (hashBits > 8 && (size_t(1) << hashBits) > size)
+        --hashBits;
+    vector<uint32_t> head(size_t(1) << hashBits, NONE);
+    vector<uint32_t> prev(chainSize, NONE);
+
+    auto hashAt = [&](size_t pos) {
+        uint32_t word;
+        memcpy(&word, data + pos, 4);
+        return (word * 2654435761u) >> (32 - hashBits);
+    };
+    auto insert = [&](size_t pos) {
+        uint32_t hash = hashAt(pos);
+        prev[pos & mask] = head[hash];
+        head[hash] = static_cast<uint32_t>(pos);
+    };
+
+    tokens.clear();
+    tokens.reserve(size / 4);
+    size_t pos = 0;
+    while (pos < size) {
+        if (size - pos < MIN_MATCH) {
+            tokens.push_back(LzToken{0, data[pos++]});
+            continue;
+        }
+        const size_t maxLength = min(MAX_MATCH, size - pos);
+        size_t bestLength = 0, bestDistance = 0;
+        uint32_t candidate = head[hashAt(pos)];
+        for (int probes = 0; candidate != NONE && pos - candidate <= window && probes < MAX_CHAIN_LENGTH; ++probes) {
+            // The byte just past the best match so far rejects most candidates without a full compare
+            const unsigned char* a = data + candidate;
+            const unsigned char* b = data + pos;
+            if (a[bestLength] == b[bestLength]) {
+                size_t length = 0;
+                while (length + 8 <= maxLength && memcmp(a + length, b + length, 8) == 0)
+                    length += 8;
+                while (length < maxLength && a[length] == b[length])
+                    ++length;
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestDistance = pos - candidate;
+                    if (length == maxLength)
+                        break;
+                }
+            }
+            uint32_t next = prev[candidate & mask];
+            if (next == NONE || next >= candidate)
+                break;
+            candidate = next;
+        }
+
+        if (bestLength < MIN_MATCH) {
+            insert(pos);
+            tokens.push_back(LzToken{0, data[pos++]});
+            continue;
+        }
+        tokens.push_back(LzToken{static_cast<uint32_t>(bestLength), static_cast<uint32_t>(bestDistance)});
+        // Positions inside the match are hashed too, later matches may start at any of them
+        const size_t end = pos + bestLength;
+        for (; pos < end && size - pos >= MIN_MATCH; ++pos)
+            insert(pos);
+        pos = end;
+    }
+}
+
+uint32_t bucketOf(uint32_t value, int& extraBits) {
+    // Values below 4 are buckets of their own, then every power of two is split into two buckets
+    // whose low bits follow the code as extra bits, as DEFLATE does for distances
+    if (value < 4) {
+        extraBits = 0;
+        return value;
+    }
+    int log = 31;
+    while ((value >> log) == 0)
+        --log;
+    extraBits = log - 1;
+    return 2 * log + ((value >> (log - 1)) & 1);
+}
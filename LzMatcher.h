@@ -0,0 +1,21 @@
+#ifndef LZ_MATCHER_H
+#define LZ_MATCHER_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+constexpr size_t MIN_MATCH = 4; // Shortest LZ match, also the width of the match finder's hash
+constexpr size_t MAX_MATCH = MIN_MATCH + 65535; // Longest LZ match, keeps length buckets below 32
+
+// Literal (length 0) or match of an LZ block
+struct LzToken {
+    uint32_t length; // Match length, 0 for a literal
+    uint32_t value; // Match distance, or the literal byte
+};
+
+// Greedy parse of size bytes into literals and matches reaching at most windowSize bytes back
+void findMatches(const unsigned char* data, size_t size, size_t windowSize, std::vector<LzToken>& tokens);
+
+// Bucket of a match length or distance and the number of its low bits sent as extra bits
+uint32_t bucketOf(uint32_t value, int& extraBits);
+#endif // LZ_MATCHER_H
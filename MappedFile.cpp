@@ -0,0 +1,88 @@
+#include "MappedFile.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        return;
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length == 0) {
+        close(fd);
+        mapped = true;
+        return;
+    }
+    void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps its own reference to the file
+    if (address == MAP_FAILED) {
+        length = 0;
+        return;
+    }
+    madvise(address, length, MADV_SEQUENTIAL);
+    bytes = static_cast<const unsigned char*>(address);
+    mapped = true;
+}
+
+MappedFile::~MappedFile() {
+    if (bytes)
+        munmap(const_cast<unsigned char*>(bytes), length);
+}
+#elif defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <cstdint>
+#include <windows.h>
+
+MappedFile::MappedFile(const string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    LARGE_INTEGER fileSize;
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &fileSize) || static_cast<uint64_t>(fileSize.QuadPart) > SIZE_MAX) {
+        CloseHandle(file);
+        return;
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0) {
+        CloseHandle(file);
+        mapped = true;
+        return;
+    }
+    // The mapping keeps the file open and the view keeps the mapping, neither handle is needed after
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        length = 0;
+        return;
+    }
+    void* address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!address) {
+        length = 0;
+        return;
+    }
+    bytes = static_cast<const unsigned char*>(address);
+    mapped = true;
+}
+
+MappedFile::~MappedFile() {
+    if (bytes)
+        UnmapViewOfFile(bytes);
+}
+#else
+MappedFile::MappedFile(const string&) {}
+
+MappedFile::~MappedFile() {}
+#endif
@@ -0,0 +1,27 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+#include <cstddef>
+#include <string>
+using namespace std;
+
+// Read-only memory mapping of a whole regular file, read sequentially.
+// isOpen() is false when the file cannot be mapped (missing file, pipe or
+// unsupported platform), and callers fall back to stream reads.
+class MappedFile {
+public:
+    explicit MappedFile(const string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return mapped; }
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const unsigned char* bytes = nullptr; // Start of the mapping, null for an empty file
+    size_t length = 0; // Size of the file in bytes
+    bool mapped = false; // True once the whole file is accessible through bytes
+};
+#endif // MAPPED_FILE_H
@@ -9,15 +9,19 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    huffmanworker.cpp \
     main.cpp \
     mainwindow.cpp
 
 HEADERS += \
+    huffmanworker.h \
     mainwindow.h
 
 FORMS += \
     mainwindow.ui
 
+include(../huffman.pri)
+
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
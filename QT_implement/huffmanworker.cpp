@@ -0,0 +1,63 @@
+#include "huffmanworker.h"
+#include "HuffmanCoding.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
+HuffmanWorker::HuffmanWorker(const QString& inputFile, const QString& compressedFile, const QString& decompressedFile)
+    : inputFile(inputFile)
+    , compressedFile(compressedFile)
+    , decompressedFile(decompressedFile)
+{
+}
+
+void HuffmanWorker::cancel()
+{
+    cancelRequested = true;
+}
+
+void HuffmanWorker::run()
+{
+    QString compressSummary, decompressSummary;
+    bool ok = runStage(false, inputFile, compressedFile, compressSummary)
+              && runStage(true, compressedFile, decompressedFile, decompressSummary);
+    if (cancelRequested) {
+        emit finished(false, true, "Cancelled\n");
+        return;
+    }
+    if (!ok) {
+        emit finished(false, false, errorMessage + "\n");
+        return;
+    }
+    emit finished(true, false, compressSummary + decompressSummary);
+}
+
+// Run one direction, reporting progress per block. If it fails, keep the codec's reason and
+// delete the partial output
+bool HuffmanWorker::runStage(bool decompress, const QString& from, const QString& to, QString& summary)
+{
+    const QString stage = decompress ? "Decompressing" : "Compressing";
+    const qint64 fileSize = QFileInfo(from).size();
+    QElapsedTimer timer;
+    timer.start();
+
+    HuffmanCoding huffman;
+    huffman.setProgressCallback([&](uint64_t done, uint64_t total) {
+        double seconds = qMax<qint64>(timer.elapsed(), 1) / 1000.0;
+        emit progress(stage, qint64(done), total ? qint64(total) : fileSize, done / 1e6 / seconds);
+        return !cancelRequested;
+    });
+    bool ok = decompress ? huffman.decompressFile(from.toStdString(), to.toStdString())
+                         : huffman.compressFile(from.toStdString(), to.toStdString());
+    if (!ok) {
+        errorMessage = QString::fromStdString(huffman.lastError());
+        QFile::remove(to);
+        return false;
+    }
+
+    // Both directions report uncompressed bytes per second
+    double seconds = qMax<qint64>(timer.elapsed(), 1) / 1000.0;
+    const qint64 rawSize = QFileInfo(decompress ? to : from).size();
+    summary = stage + " done: " + QString::number(rawSize / 1e6 / seconds, 'f', 1) + " MB/s\n";
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef HUFFMANWORKER_H
+#define HUFFMANWORKER_H
+
+#include <QObject>
+#include <QString>
+#include <atomic>
+
+// Runs the compress and decompress round trip of the window on its own thread.
+// Move it to a QThread and connect QThread::started to run().
+class HuffmanWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    HuffmanWorker(const QString& inputFile, const QString& compressedFile, const QString& decompressedFile);
+
+    // Safe to call from any thread, the job stops after the block in flight
+    void cancel();
+
+public slots:
+    void run();
+
+signals:
+    // Emitted after every block with the input bytes consumed and the live throughput
+    void progress(const QString& stage, qint64 done, qint64 total, double mbPerSecond);
+    // Emitted once when the job ends, message holds the summary or the error
+    void finished(bool ok, bool cancelled, const QString& message);
+
+private:
+    bool runStage(bool decompress, const QString& inputFile, const QString& outputFile, QString& summary);
+
+    QString inputFile;
+    QString compressedFile;
+    QString decompressedFile;
+    QString errorMessage; // Reason the failed stage gave
+    std::atomic<bool> cancelRequested{false};
+};
+
+#endif // HUFFMANWORKER_H
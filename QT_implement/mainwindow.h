@@ -2,33 +2,14 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <unordered_map>
-#include <bitset>
-#include <queue>
+#include <QPointer>
+#include "huffmanworker.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
-struct MinHeapNode {
-    char data;
-    unsigned freq;
-    struct MinHeapNode* left, * right;
-};
-
-struct MinHeap {
-    std::vector<MinHeapNode*> array;
-};
-
-MinHeapNode* newNode(char data, unsigned freq);
-void swapMinHeapNode(MinHeapNode** a, MinHeapNode** b);
-void minHeapify(struct MinHeap* minHeap, int idx);
-MinHeapNode* extractMin(struct MinHeap* minHeap);
-void insertMinHeap(struct MinHeap* minHeap, struct MinHeapNode* minHeapNode);
-void buildMinHeap(struct MinHeap* minHeap);
-MinHeap* createAndBuildMinHeap(const std::unordered_map<char, unsigned>& freqmap);
-MinHeapNode* buildHuffmanTree(const std::unordered_map<char, unsigned>& freqmap);
-void generateHuffmanCodes(MinHeapNode* root, std::string code, std::unordered_map<char, std::string>& huffmanCodes);
+class QThread;
 
 class MainWindow : public QMainWindow
 {
@@ -37,17 +18,19 @@ class MainWindow : public QMainWindow
 public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
-    void compressFile(const std::string& inputFile, const std::string& outputFile);
-    void decompressFile(const std::string& inputFile, const std::string& outputFile);
 
 private slots:
 
 
     void on_compressButton_clicked();
+    void showProgress(const QString& stage, qint64 done, qint64 total, double mbPerSecond);
+    void jobFinished(bool ok, bool cancelled, const QString& message);
 
 
 private:
     Ui::MainWindow *ui;
+    QPointer<HuffmanWorker> worker; // Running job, null while idle
+    QPointer<QThread> workerThread; // Thread of the running job
 
 };
 
@@ -0,0 +1,124 @@
+#include "SuffixArray.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// Start (or end) of the bucket of every symbol in sa, from the count of each symbol
+void getBuckets(const vector<int32_t>& counts, vector<int32_t>& bucket, bool end) {
+    bucket.resize(counts.size());
+    int32_t sum = 0;
+    for (size_t symbol = 0; symbol < counts.size(); ++symbol) {
+        sum += counts[symbol];
+        bucket[symbol] = end ? sum : sum - counts[symbol];
+    }
+}
+
+// L-type suffixes are placed from the sorted suffixes left to right, S-type ones right to left
+void induceSort(const int32_t* s, int32_t* sa, int32_t n, const vector<int32_t>& counts, const vector<uint8_t>& sType, vector<int32_t>& bucket) {
+    getBuckets(counts, bucket, false);
+    for (int32_t i = 0; i < n; ++i) {
+        int32_t j = sa[i] - 1;
+        if (j >= 0 && !sType[j])
+            sa[bucket[s[j]]++] = j;
+    }
+    getBuckets(counts, bucket, true);
+    for (int32_t i = n - 1; i >= 0; --i) {
+        int32_t j = sa[i] - 1;
+        if (j >= 0 && sType[j])
+            sa[--bucket[s[j]]] = j;
+    }
+}
+
+// SA-IS of s[0..n), whose last symbol is a unique smallest sentinel (Nong, Zhang and Chan)
+void sais(const int32_t* s, int32_t* sa, int32_t n, int32_t maxSymbol) {
+    // A suffix is S-type when it is smaller than the suffix after it, LMS when it is the leftmost of a run of S-types
+    vector<uint8_t> sType(n);
+    sType[n - 1] = true;
+    for (int32_t i = n - 2; i >= 0; --i)
+        sType[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && sType[i + 1]);
+    auto isLms = [&](int32_t i) { return i > 0 && sType[i] && !sType[i - 1]; };
+
+    // Sort the LMS substrings by inducing from LMS positions dropped at their bucket ends
+    vector<int32_t> counts(maxSymbol + 1, 0), bucket;
+    for (int32_t i = 0; i < n; ++i)
+        counts[s[i]]++;
+    getBuckets(counts, bucket, true);
+    fill(sa, sa + n, -1);
+    for (int32_t i = 1; i < n; ++i) {
+        if (isLms(i))
+            sa[--bucket[s[i]]] = i;
+    }
+    induceSort(s, sa, n, counts, sType, bucket);
+
+    // Name the sorted LMS substrings, equal substrings get equal names
+    int32_t lmsCount = 0;
+    for (int32_t i = 0; i < n; ++i) {
+        if (isLms(sa[i]))
+            sa[lmsCount++] = sa[i];
+    }
+    fill(sa + lmsCount, sa + n, -1);
+    int32_t names = 0, previous = -1;
+    for (int32_t i = 0; i < lmsCount; ++i) {
+        int32_t pos = sa[i];
+        bool differs = false;
+        for (int32_t d = 0; d < n; ++d) {
+            if (previous == -1 || s[pos + d] != s[previous + d] || sType[pos + d] != sType[previous + d]) {
+                differs = true;
+                break;
+            }
+            if (d > 0 && (isLms(pos + d) || isLms(previous + d)))
+                break;
+        }
+        if (differs) {
+            ++names;
+            previous = pos;
+        }
+        sa[lmsCount + pos / 2] = names - 1;
+    }
+    for (int32_t i = n - 1, j = n - 1; i >= lmsCount; --i) {
+        if (sa[i] >= 0)
+            sa[j--] = sa[i];
+    }
+
+    // Sort the reduced string of names, recursively while names repeat
+    int32_t* reducedSa = sa;
+    int32_t* reduced = sa + n - lmsCount;
+    if (names < lmsCount) {
+        sais(reduced, reducedSa, lmsCount, names - 1);
+    } else {
+        for (int32_t i = 0; i < lmsCount; ++i)
+            reducedSa[reduced[i]] = i;
+    }
+
+    // Place the LMS suffixes in their sorted order and induce all other suffixes from them
+    getBuckets(counts, bucket, true);
+    for (int32_t i = 1, j = 0; i < n; ++i) {
+        if (isLms(i))
+            reduced[j++] = i;
+    }
+    for (int32_t i = 0; i < lmsCount; ++i)
+        reducedSa[i] = reduced[reducedSa[i]];
+    fill(sa + lmsCount, sa + n, -1);
+    for (int32_t i = lmsCount - 1; i >= 0; --i) {
+        int32_t j = sa[i];
+        sa[i] = -1;
+        sa[--bucket[s[j]]] = j;
+    }
+    induceSort(s, sa, n, counts, sType, bucket);
+}
+
+} // namespace
+
+void buildSuffixArray(const unsigned char* data, size_t size, vector<int32_t>& sa) {
+    // Bytes are shifted up by one to make room for the sentinel, whose suffix sorts first
+    const int32_t n = static_cast<int32_t>(size) + 1;
+    vector<int32_t> s(n);
+    for (size_t i = 0; i < size; ++i)
+        s[i] = data[i] + 1;
+    s[n - 1] = 0;
+    sa.resize(n);
+    sais(s.data(), sa.data(), n, 256);
+    sa.erase(sa.begin());
+}
@@ -0,0 +1,11 @@
+#ifndef SUFFIX_ARRAY_H
+#define SUFFIX_ARRAY_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Suffix array of size bytes by SA-IS (induced sorting) in linear time: sa[i] is the start of the
+// i-th smallest suffix, and a suffix sorts before the longer suffixes it is a prefix of.
+// size must be below 2^31.
+void buildSuffixArray(const unsigned char* data, size_t size, std::vector<int32_t>& sa);
+#endif // SUFFIX_ARRAY_H
@@ -0,0 +1,72 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+// Fixed-size pool of worker threads running queued tasks in submission order
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads) {
+        for (unsigned i = 0; i < max(1u, threads); ++i)
+            workers.emplace_back([this] { run(); });
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task, the returned future becomes ready once it has run
+    template <class Task>
+    future<typename invoke_result<Task>::type> submit(Task task) {
+        using Result = typename invoke_result<Task>::type;
+        auto job = make_shared<packaged_task<Result()>>(move(task));
+        future<Result> result = job->get_future();
+        {
+            lock_guard<mutex> lock(queueMutex);
+            tasks.push([job] { (*job)(); });
+        }
+        wake.notify_one();
+        return result;
+    }
+
+private:
+    vector<thread> workers; // Worker threads
+    queue<function<void()>> tasks; // Tasks waiting for a worker
+    mutex queueMutex; // Guards tasks and stopping
+    condition_variable wake; // Signalled when a task is queued or the pool stops
+    bool stopping = false;
+
+    void run() {
+        while (true) {
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(queueMutex);
+                wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+};
+#endif // THREAD_POOL_H
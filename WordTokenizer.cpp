@@ -0,0 +1,32 @@
+#include "WordTokenizer.h"
+#include <unordered_map>
+
+using namespace std;
+
+bool tokenizeWords(const unsigned char* data, size_t size, vector<string_view>& dictionary, vector<uint16_t>& tokens) {
+    // Words are runs of letters, digits, '_' and non-ASCII bytes, any other byte is a token by itself
+    auto isWordByte = [](unsigned char c) { return unsigned((c | 0x20) - 'a') < 26 || unsigned(c - '0') < 10 || c == '_' || c >= 0x80; };
+    const size_t MAX_TOKENS = size_t(1) << 16;
+    unordered_map<string_view, uint16_t> ids;
+    dictionary.clear();
+    tokens.clear();
+    tokens.reserve(size / 3);
+    for (size_t pos = 0; pos < size;) {
+        size_t length = 1;
+        if (isWordByte(data[pos])) {
+            while (pos + length < size && length < MAX_TOKEN_LENGTH && isWordByte(data[pos + length]))
+                ++length;
+        }
+        string_view token(reinterpret_cast<const char*>(data + pos), length);
+        auto found = ids.find(token);
+        if (found == ids.end()) {
+            if (dictionary.size() == MAX_TOKENS)
+                return false;
+            found = ids.emplace(token, static_cast<uint16_t>(dictionary.size())).first;
+            dictionary.push_back(token);
+        }
+        tokens.push_back(found->second);
+        pos += length;
+    }
+    return true;
+}
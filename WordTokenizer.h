@@ -0,0 +1,14 @@
+#ifndef WORD_TOKENIZER_H
+#define WORD_TOKENIZER_H
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+constexpr size_t MAX_TOKEN_LENGTH = 255; // Longer words are split, lengths are stored in a byte
+
+// Splits size bytes into words and single-byte tokens. dictionary receives the distinct tokens in
+// order of first occurrence, viewing data, and tokens the id of each token. False when there are
+// more distinct tokens than 16-bit ids.
+bool tokenizeWords(const unsigned char* data, size_t size, std::vector<std::string_view>& dictionary, std::vector<uint16_t>& tokens);
+#endif // WORD_TOKENIZER_H
@@ -0,0 +1,256 @@
+#include "HuffmanCoding.h" // Include the header file for HuffmanCoding class
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <random>
+#include <sstream>
+using namespace std::chrono;
+
+// Benchmark of every codec path over generated corpora, printed as JSON.
+// Usage: benchmark [--size MB] [--repeats N] [--out file]
+
+// Global allocation counters, updated by the replaced operator new
+static atomic<uint64_t> allocationCount(0);
+static atomic<uint64_t> allocatedBytes(0);
+
+// GCC sees free() on memory from operator new, it cannot tell that the replacement allocates with malloc
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    allocatedBytes.fetch_add(size, memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1))
+        return p;
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// Field of /proc/self/status in KB, -1 where the file or the field does not exist
+static long processStatusKb(const char* field) {
+    ifstream status("/proc/self/status");
+    string line;
+    size_t length = strlen(field);
+    while (getline(status, line)) {
+        if (line.compare(0, length, field) == 0 && line.size() > length && line[length] == ':')
+            return stol(line.substr(length + 1));
+    }
+    return -1;
+}
+
+// Reset the peak resident set size of the process, returns false where it cannot be reset. Only
+// Linux supports this, through clear_refs, and a kernel that accepts the write without resetting
+// is caught by the peak staying above the current size. Elsewhere the only peak available is the
+// high-water mark of the whole run, which says nothing about one case
+static bool resetPeakRss() {
+#ifdef __linux__
+    {
+        ofstream clearRefs("/proc/self/clear_refs");
+        clearRefs << "5" << flush;
+        if (!clearRefs)
+            return false;
+    }
+    long peak = processStatusKb("VmHWM");
+    return peak >= 0 && peak <= processStatusKb("VmRSS");
+#else
+    return false;
+#endif
+}
+
+static vector<uint8_t> makeCorpus(const string& name, size_t size) {
+    mt19937 rng(12345);
+    vector<uint8_t> data;
+    data.reserve(size);
+    if (name == "random") {
+        while (data.size() < size)
+            data.push_back(static_cast<uint8_t>(rng()));
+    } else if (name == "skewed") {
+        // Geometric distribution, byte k is about twice as likely as byte k + 1
+        geometric_distribution<int> dist(0.5);
+        while (data.size() < size)
+            data.push_back(static_cast<uint8_t>(min(dist(rng), 255)));
+    } else if (name == "text") {
+        static const char* words[] = {"the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with",
+                                      "be", "by", "on", "not", "he", "this", "are", "or", "his", "from", "at", "which",
+                                      "compression", "Huffman", "tree", "frequency", "symbol", "encoded", "stream"};
+        const size_t wordCount = sizeof(words) / sizeof(words[0]);
+        size_t lineLength = 0;
+        while (data.size() < size) {
+            const char* word = words[rng() % wordCount];
+            data.insert(data.end(), word, word + strlen(word));
+            lineLength += strlen(word) + 1;
+            if (rng() % 12 == 0)
+                data.push_back(rng() % 2 ? ',' : '.');
+            if (lineLength > 70) {
+                data.push_back('\n');
+                lineLength = 0;
+            } else {
+                data.push_back(' ');
+            }
+        }
+    } else if (name == "binary") {
+        // Fixed-size records: a slowly increasing id, a small signed delta and a float
+        uint32_t id = 0;
+        while (data.size() < size) {
+            id += 1 + rng() % 4;
+            int16_t delta = static_cast<int16_t>(static_cast<int>(rng() % 64) - 32);
+            float value = static_cast<float>(rng() % 1000) / 8.0f;
+            uint8_t record[10];
+            memcpy(record, &id, 4);
+            memcpy(record + 4, &delta, 2);
+            memcpy(record + 6, &value, 4);
+            data.insert(data.end(), record, record + 10);
+        }
+    } else if (name == "samples") {
+        // 12-bit sensor readings as 16-bit little-endian values, drifting slowly with some noise
+        double level = 2048;
+        normal_distribution<double> noise(0.0, 12.0);
+        while (data.size() < size) {
+            level = min(4000.0, max(100.0, level + noise(rng) / 8));
+            uint16_t sample = static_cast<uint16_t>(level + noise(rng));
+            data.push_back(static_cast<uint8_t>(sample));
+            data.push_back(static_cast<uint8_t>(sample >> 8));
+        }
+    } else {
+        data.assign(size, 'A');
+    }
+    data.resize(size);
+    return data;
+}
+
+// Throughput percentiles of one direction of one case
+struct Measurement {
+    vector<double> mbPerSecond; // One sample per repeat
+    uint64_t allocations = 0; // Allocations of the last repeat
+    uint64_t allocatedBytes = 0; // Bytes allocated by the last repeat
+    long peakRssKb = 0; // Largest peak RSS of any repeat, -1 when the peak could not be measured per case
+};
+
+static double percentile(vector<double> samples, double p) {
+    sort(samples.begin(), samples.end());
+    size_t index = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+    return samples[index];
+}
+
+static void writeMeasurement(ostream& out, const Measurement& m) {
+    out << "{\"mb_per_s\": {\"min\": " << percentile(m.mbPerSecond, 0.0) << ", \"p50\": " << percentile(m.mbPerSecond, 0.5)
+        << ", \"p90\": " << percentile(m.mbPerSecond, 0.9) << ", \"max\": " << percentile(m.mbPerSecond, 1.0)
+        << "}, \"allocations\": " << m.allocations << ", \"allocated_bytes\": " << m.allocatedBytes
+        << ", \"peak_rss_kb\": ";
+    if (m.peakRssKb < 0)
+        out << "null";
+    else
+        out << m.peakRssKb;
+    out << "}";
+}
+
+// Run one timed operation and record its throughput, allocations and peak memory
+template <class Operation>
+static void measure(Measurement& m, size_t bytes, Operation operation) {
+    bool peakReset = resetPeakRss();
+    uint64_t allocationsBefore = allocationCount.load();
+    uint64_t bytesBefore = allocatedBytes.load();
+    auto start = steady_clock::now();
+    operation();
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    m.mbPerSecond.push_back(bytes / 1e6 / max(seconds, 1e-9));
+    m.allocations = allocationCount.load() - allocationsBefore;
+    m.allocatedBytes = allocatedBytes.load() - bytesBefore;
+    long peak = peakReset ? processStatusKb("VmHWM") : -1;
+    m.peakRssKb = peak < 0 || m.peakRssKb < 0 ? -1 : max(m.peakRssKb, peak);
+}
+
+int main(int argc, char* argv[]) {
+    size_t size = 16 << 20;
+    int repeats = 5;
+    string outputFile;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i];
+        if (option == "--size")
+            size = static_cast<size_t>(stod(argv[i + 1]) * (1 << 20));
+        else if (option == "--repeats")
+            repeats = max(1, stoi(argv[i + 1]));
+        else if (option == "--out")
+            outputFile = argv[i + 1];
+    }
+
+    // Codec paths: decoder, thread count, whether a shared table trained on the corpus is used, the mode
+    // and whether blocks are split into four streams
+    struct Path {
+        string name;
+        HuffmanCoding::DecoderType decoder;
+        unsigned threads;
+        bool shared;
+        HuffmanCoding::Mode mode;
+        bool interleaved;
+    };
+    const HuffmanCoding::Mode staticMode = HuffmanCoding::Mode::Static;
+    vector<Path> paths = {{"table", HuffmanCoding::DecoderType::Table, 1, false, staticMode, false},
+                          {"interleaved", HuffmanCoding::DecoderType::Table, 1, false, staticMode, true},
+                          {"tree", HuffmanCoding::DecoderType::TreeWalk, 1, false, staticMode, false},
+                          {"shared", HuffmanCoding::DecoderType::Table, 1, true, staticMode, false},
+                          {"adaptive", HuffmanCoding::DecoderType::Table, 1, false, HuffmanCoding::Mode::Adaptive, false},
+                          {"context", HuffmanCoding::DecoderType::Table, 1, false, HuffmanCoding::Mode::Context, false},
+                          {"wide", HuffmanCoding::DecoderType::Table, 1, false, HuffmanCoding::Mode::Wide, false},
+                          {"words", HuffmanCoding::DecoderType::Table, 1, false, HuffmanCoding::Mode::Words, false},
+                          {"lz", HuffmanCoding::DecoderType::Table, 1, false, HuffmanCoding::Mode::Lz, false},
+                          {"bwt", HuffmanCoding::DecoderType::Table, 1, false, HuffmanCoding::Mode::Bwt, false}};
+    // Speedup curve of the table path: 2, 4, 8, ... threads, ending at every hardware thread
+    unsigned hardwareThreads = thread::hardware_concurrency();
+    for (unsigned threads = 2; threads < 2 * hardwareThreads; threads *= 2)
+        paths.push_back({"table", HuffmanCoding::DecoderType::Table, min(threads, hardwareThreads), false, staticMode, false});
+
+    ostringstream json;
+    json << "{\"size_bytes\": " << size << ", \"repeats\": " << repeats << ", \"results\": [";
+    bool first = true;
+    for (const char* corpus : {"random", "skewed", "text", "binary", "samples", "one-byte"}) {
+        vector<uint8_t> input = makeCorpus(corpus, size);
+        for (const Path& path : paths) {
+            HuffmanCoding huffman;
+            huffman.setThreadCount(path.threads);
+            huffman.setMode(path.mode);
+            huffman.setInterleaved(path.interleaved);
+            if (path.shared)
+                huffman.trainTable(input.data(), min<size_t>(input.size(), 1 << 16));
+            vector<uint8_t> compressed, decompressed;
+            Measurement compress, decompress;
+            for (int r = 0; r < repeats; ++r) {
+                measure(compress, size, [&] { huffman.compress(input.data(), input.size(), compressed); });
+                measure(decompress, size, [&] { huffman.decompress(compressed.data(), compressed.size(), decompressed, path.decoder); });
+            }
+            if (decompressed != input) {
+                cerr << "Round trip failed: " << corpus << " / " << path.name << endl;
+                return 1;
+            }
+
+            json << (first ? "" : ",") << "\n  {\"corpus\": \"" << corpus << "\", \"path\": \"" << path.name
+                 << "\", \"threads\": " << path.threads << ", \"ratio\": " << double(size) / compressed.size()
+                 << ", \"compressed_bytes\": " << compressed.size() << ",\n   \"compress\": ";
+            writeMeasurement(json, compress);
+            json << ",\n   \"decompress\": ";
+            writeMeasurement(json, decompress);
+            json << "}";
+            first = false;
+        }
+    }
+    json << "\n]}\n";
+
+    if (outputFile.empty()) {
+        cout << json.str();
+    } else {
+        ofstream out(outputFile);
+        out << json.str();
+    }
+    return 0;
+}
@@ -0,0 +1,9 @@
+# Benchmark of the codec over generated corpora
+TEMPLATE = app
+TARGET = benchmark
+CONFIG += console c++17
+CONFIG -= qt app_bundle
+
+SOURCES += $$HUFFMAN_ROOT/benchmark.cpp
+
+include(../huffman.pri)
@@ -0,0 +1,9 @@
+# Command line tool
+TEMPLATE = app
+TARGET = huff
+CONFIG += console c++17
+CONFIG -= qt app_bundle
+
+SOURCES += $$HUFFMAN_ROOT/main.cpp
+
+include(../huffman.pri)
@@ -0,0 +1,30 @@
+# Huffman codec library shared by the command line tool, the benchmark and the GUI
+TEMPLATE = lib
+TARGET = huffman
+CONFIG += staticlib c++17
+CONFIG -= qt
+DESTDIR = $$HUFFMAN_BUILD_ROOT/lib
+
+INCLUDEPATH += $$HUFFMAN_ROOT
+
+SOURCES += \
+    $$HUFFMAN_ROOT/AdaptiveModel.cpp \
+    $$HUFFMAN_ROOT/ContextClustering.cpp \
+    $$HUFFMAN_ROOT/Crc32c.cpp \
+    $$HUFFMAN_ROOT/HuffmanCoding.cpp \
+    $$HUFFMAN_ROOT/LzMatcher.cpp \
+    $$HUFFMAN_ROOT/MappedFile.cpp \
+    $$HUFFMAN_ROOT/SuffixArray.cpp \
+    $$HUFFMAN_ROOT/WordTokenizer.cpp
+
+HEADERS += \
+    $$HUFFMAN_ROOT/AdaptiveModel.h \
+    $$HUFFMAN_ROOT/BitStream.h \
+    $$HUFFMAN_ROOT/ContextClustering.h \
+    $$HUFFMAN_ROOT/Crc32c.h \
+    $$HUFFMAN_ROOT/HuffmanCoding.h \
+    $$HUFFMAN_ROOT/LzMatcher.h \
+    $$HUFFMAN_ROOT/MappedFile.h \
+    $$HUFFMAN_ROOT/SuffixArray.h \
+    $$HUFFMAN_ROOT/ThreadPool.h \
+    $$HUFFMAN_ROOT/WordTokenizer.h
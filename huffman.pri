@@ -0,0 +1,8 @@
+# Include from a front end project to build against the codec library of codec/codec.pro
+INCLUDEPATH += $$HUFFMAN_ROOT
+DEPENDPATH += $$HUFFMAN_ROOT
+
+LIBS += -L$$HUFFMAN_BUILD_ROOT/lib -lhuffman
+win32-msvc*: PRE_TARGETDEPS += $$HUFFMAN_BUILD_ROOT/lib/huffman.lib
+else: PRE_TARGETDEPS += $$HUFFMAN_BUILD_ROOT/lib/libhuffman.a
+unix: LIBS += -pthread
@@ -1,30 +1,284 @@
 #include "HuffmanCoding.h" // Include the header file for HuffmanCoding class
+#include <cctype>
 #include <chrono>
+#include <mutex>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 using namespace std::chrono;
-int main() {
-    HuffmanCoding huffman;
-
-    string inputFile, compressedFile, decompressedFile;
-
-    // Get file names from user
-    cout << "Enter input file name: ";
-    cin >> inputFile;
-    cout << "Enter compressed file name: ";
-    cin >> compressedFile;
-    cout << "Enter decompressed file name: ";
-    cin >> decompressedFile;
-
-    // Compress the input file and then decompress it
-    auto compress_start = high_resolution_clock::now();
-    huffman.compressFile(inputFile, compressedFile);
-    auto compress_stop = high_resolution_clock::now();
-    auto decompress_start = high_resolution_clock::now();
-    huffman.decompressFile(compressedFile, decompressedFile);
-    auto decompress_stop = high_resolution_clock::now();
-    auto compress_duration = duration_cast<microseconds>(compress_stop - compress_start);
-    auto decompress_duration = duration_cast<microseconds>(decompress_stop - decompress_start);
-    cout << "Compression time: " << compress_duration.count() << " microseconds" << endl;
-    cout << "Decompression time: " << decompress_duration.count() << " microseconds" << endl;
-
-    return 0;
-}
\ No newline at end of file
+
+// Command line front end: huff [-c|-d] [options] [file...]
+// With no files, or with "-", data is read from stdin and written to stdout.
+
+static const char* EXTENSION = ".huf"; // Appended to compressed file names
+
+static void printUsage() {
+    cerr << "Usage: huff [-c|-d] [options] [file...]\n"
+            "  -c, --compress        compress (default)\n"
+            "  -d, --decompress      decompress\n"
+            "  -a, --adaptive        adaptive Huffman, one pass with low latency on streams\n"
+            "  -x, --context         order-1 context modelling, smaller output on text and logs\n"
+            "  -u, --u16             code 16-bit little-endian symbols, smaller output on numeric columns\n"
+            "  -w, --words           code word and punctuation tokens, smaller output on repetitive text\n"
+            "  -z, --lz              LZ77 matches coded with Huffman tables, much smaller output on logs\n"
+            "  -B, --bwt             Burrows-Wheeler transform and move-to-front, smallest output on text\n"
+            "  -W, --window N        LZ match window in bytes, K and M suffixes allowed (default: 256K)\n"
+            "  -i, --interleaved     four streams per block for faster decoding\n"
+            "  -r, --range OFF:LEN   decompress only LEN bytes from offset OFF of one file\n"
+            "  -o, --output FILE     output file for a single input, - for stdout\n"
+            "  -t, --threads N       threads used in total (default: all cores)\n"
+            "  -b, --block-size N    block size in bytes, K and M suffixes allowed\n"
+            "  -v, --verbose         report the time taken for each file\n"
+            "  -h, --help            show this help\n"
+            "Files are processed concurrently. file is written to file" << EXTENSION << " and back.\n"
+            "With no file, or -, data is streamed from stdin to stdout.\n";
+}
+
+// Parse a size such as 65536, 64K or 4M, rejecting signs and values that do not fit in size_t
+static bool parseSize(const string& text, size_t& size, bool allowZero = false) {
+    if (text.empty() || !isdigit(static_cast<unsigned char>(text[0])))
+        return false;
+    size_t pos = 0;
+    unsigned long long value;
+    try {
+        value = stoull(text, &pos);
+    } catch (const exception&) {
+        return false;
+    }
+    string suffix = text.substr(pos);
+    int shift = 0;
+    if (suffix == "K" || suffix == "k")
+        shift = 10;
+    else if (suffix == "M" || suffix == "m")
+        shift = 20;
+    else if (!suffix.empty())
+        return false;
+    if (value > (SIZE_MAX >> shift))
+        return false;
+    size = static_cast<size_t>(value) << shift;
+    return allowZero || size > 0;
+}
+
+// Output name of a file: file.huf when compressing, file without .huf (or file.out) when decompressing
+static string outputName(const string& inputFile, bool decompress) {
+    if (!decompress)
+        return inputFile + EXTENSION;
+    size_t length = strlen(EXTENSION);
+    if (inputFile.size() > length && inputFile.compare(inputFile.size() - length, length, EXTENSION) == 0)
+        return inputFile.substr(0, inputFile.size() - length);
+    return inputFile + ".out";
+}
+
+int main(int argc, char* argv[]) {
+    bool decompress = false, verbose = false, interleaved = false;
+    HuffmanCoding::Mode mode = HuffmanCoding::Mode::Static;
+    string modeFlag; // The flag that chose mode, empty for the default
+    size_t windowSize = HuffmanCoding::DEFAULT_WINDOW_SIZE;
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    size_t blockSize = HuffmanCoding::DEFAULT_BLOCK_SIZE;
+    string outputFile;
+    vector<string> inputFiles;
+    bool range = false;
+    uint64_t rangeOffset = 0;
+    size_t rangeLength = 0;
+
+    // At most one mode flag may be given, repeating it is harmless
+    auto selectMode = [&](const string& flag, HuffmanCoding::Mode flagMode) {
+        if (!modeFlag.empty() && mode != flagMode) {
+            cerr << modeFlag << " and " << flag << " select different modes, give only one" << endl;
+            return false;
+        }
+        mode = flagMode;
+        modeFlag = flag;
+        return true;
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-c" || arg == "--compress") {
+            decompress = false;
+        } else if (arg == "-d" || arg == "--decompress") {
+            decompress = true;
+        } else if (arg == "-a" || arg == "--adaptive") {
+            if (!selectMode(arg, HuffmanCoding::Mode::Adaptive))
+                return 2;
+        } else if (arg == "-x" || arg == "--context") {
+            if (!selectMode(arg, HuffmanCoding::Mode::Context))
+                return 2;
+        } else if (arg == "-u" || arg == "--u16") {
+            if (!selectMode(arg, HuffmanCoding::Mode::Wide))
+                return 2;
+        } else if (arg == "-w" || arg == "--words") {
+            if (!selectMode(arg, HuffmanCoding::Mode::Words))
+                return 2;
+        } else if (arg == "-z" || arg == "--lz") {
+            if (!selectMode(arg, HuffmanCoding::Mode::Lz))
+                return 2;
+        } else if (arg == "-B" || arg == "--bwt") {
+            if (!selectMode(arg, HuffmanCoding::Mode::Bwt))
+                return 2;
+        } else if (arg == "-i" || arg == "--interleaved") {
+            interleaved = true;
+        } else if (arg == "-v" || arg == "--verbose") {
+            verbose = true;
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else if ((arg == "-o" || arg == "--output") && hasValue) {
+            outputFile = argv[++i];
+        } else if ((arg == "-t" || arg == "--threads") && hasValue) {
+            size_t count;
+            if (!parseSize(argv[++i], count)) {
+                cerr << "Invalid thread count: " << argv[i] << endl;
+                return 2;
+            }
+            threads = static_cast<unsigned>(min<size_t>(count, 1024));
+        } else if ((arg == "-r" || arg == "--range") && hasValue) {
+            string value = argv[++i];
+            size_t colon = value.find(':');
+            size_t offset;
+            if (colon == string::npos || !parseSize(value.substr(0, colon), offset, true) || !parseSize(value.substr(colon + 1), rangeLength, true)) {
+                cerr << "Invalid range: " << value << endl;
+                return 2;
+            }
+            rangeOffset = offset;
+            range = decompress = true;
+        } else if ((arg == "-W" || arg == "--window") && hasValue) {
+            if (!parseSize(argv[++i], windowSize) || windowSize > HuffmanCoding::MAX_WINDOW_SIZE) {
+                cerr << "Invalid window size: " << argv[i] << endl;
+                return 2;
+            }
+        } else if ((arg == "-b" || arg == "--block-size") && hasValue) {
+            if (!parseSize(argv[++i], blockSize) || blockSize > HuffmanCoding::MAX_BLOCK_SIZE) {
+                cerr << "Invalid block size: " << argv[i] << endl;
+                return 2;
+            }
+        } else if (arg == "-" || arg.empty() || arg[0] != '-') {
+            inputFiles.push_back(arg);
+        } else {
+            cerr << "Unknown option: " << arg << endl;
+            printUsage();
+            return 2;
+        }
+    }
+    if (inputFiles.empty())
+        inputFiles.push_back("-");
+    if (!outputFile.empty() && inputFiles.size() > 1) {
+        cerr << "-o needs exactly one input file" << endl;
+        return 2;
+    }
+    if (count(inputFiles.begin(), inputFiles.end(), "-") > 1) {
+        cerr << "stdin can only be read once" << endl;
+        return 2;
+    }
+    // The decompressor follows whatever the frames say, and adaptive frames have no streams to split
+    if (interleaved && decompress)
+        cerr << "Warning: -i has no effect when decompressing" << endl;
+    else if (interleaved && mode == HuffmanCoding::Mode::Adaptive)
+        cerr << "Warning: -i has no effect with " << modeFlag << endl;
+    else if (interleaved && mode != HuffmanCoding::Mode::Static)
+        cerr << "Warning: with " << modeFlag << ", -i only splits blocks that fall back to byte-by-byte coding" << endl;
+
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+#ifdef _WIN32
+    // Console streams translate line endings in text mode, piped data has to pass through byte for byte
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    if (range) {
+        // Only the blocks covering the range are decoded, the bytes go to -o or stdout
+        if (inputFiles.size() != 1 || inputFiles[0] == "-") {
+            cerr << "--range needs exactly one input file" << endl;
+            return 2;
+        }
+        HuffmanCoding huffman;
+        huffman.setThreadCount(threads);
+        vector<uint8_t> bytes;
+        if (!huffman.decompressRange(inputFiles[0], rangeOffset, rangeLength, bytes))
+            return 1;
+        ofstream outFile;
+        if (!outputFile.empty() && outputFile != "-") {
+            outFile.open(outputFile, ios::binary);
+            if (!outFile) {
+                cerr << "Error opening output file: " << outputFile << endl;
+                return 1;
+            }
+        }
+        ostream& out = outFile.is_open() ? outFile : cout;
+        out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        out.flush();
+        return out ? 0 : 1;
+    }
+
+    // Files run side by side, and the thread budget is split between them for their blocks
+    const unsigned workers = static_cast<unsigned>(min<size_t>(threads, inputFiles.size()));
+    const unsigned threadsPerFile = max(1u, threads / workers);
+    mutex reportMutex;
+
+    auto process = [&](const string& inputFile) {
+        HuffmanCoding huffman;
+        huffman.setBlockSize(blockSize);
+        huffman.setThreadCount(threadsPerFile);
+        huffman.setInterleaved(interleaved);
+        huffman.setWindowSize(windowSize);
+        huffman.setMode(mode);
+        string target = outputFile.empty() ? (inputFile == "-" ? "-" : outputName(inputFile, decompress)) : outputFile;
+
+        auto start = high_resolution_clock::now();
+        bool ok;
+        if (inputFile == "-" || target == "-") {
+            // Streaming through stdin or stdout, no temporary files and memory bounded by the block size
+            ifstream inFile;
+            ofstream outFile;
+            if (inputFile != "-") {
+                inFile.open(inputFile, ios::binary);
+                if (!inFile) {
+                    cerr << "Error opening input file: " << inputFile << endl;
+                    return false;
+                }
+            }
+            if (target != "-") {
+                outFile.open(target, ios::binary);
+                if (!outFile) {
+                    cerr << "Error opening output file: " << target << endl;
+                    return false;
+                }
+            }
+            istream& in = inputFile == "-" ? cin : inFile;
+            ostream& out = target == "-" ? cout : outFile;
+            ok = decompress ? huffman.decompressStream(in, out) : huffman.compressStream(in, out);
+            out.flush();
+            ok = ok && static_cast<bool>(out);
+            if (!ok)
+                cerr << "Error " << (decompress ? "decompressing " : "compressing ") << (inputFile == "-" ? "stdin" : inputFile) << endl;
+        } else {
+            ok = decompress ? huffman.decompressFile(inputFile, target) : huffman.compressFile(inputFile, target);
+        }
+        auto duration = duration_cast<microseconds>(high_resolution_clock::now() - start);
+
+        if (ok && verbose) {
+            lock_guard<mutex> lock(reportMutex);
+            cerr << (inputFile == "-" ? "stdin" : inputFile) << " -> " << (target == "-" ? "stdout" : target) << ": "
+                 << duration.count() << " microseconds" << endl;
+        }
+        return ok;
+    };
+
+    bool ok = true;
+    if (workers == 1) {
+        for (const string& inputFile : inputFiles)
+            ok = process(inputFile) && ok;
+    } else {
+        ThreadPool pool(workers);
+        vector<future<bool>> results;
+        for (const string& inputFile : inputFiles)
+            results.push_back(pool.submit([&process, &inputFile] { return process(inputFile); }));
+        for (future<bool>& result : results)
+            ok = result.get() && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+#include "testing.h"
+
+// Error reporting and cancellation of the file and in-memory APIs
+
+// The file API keeps the reason of a failure for front ends that do not show cerr
+void testFileErrors() {
+    const string missing = (filesystem::temp_directory_path() / "huffman_test.missing").string();
+    const string output = (filesystem::temp_directory_path() / "huffman_test.out").string();
+    HuffmanCoding huffman;
+    check(!huffman.decompressFile(missing, output) && huffman.lastError() == "Error opening input file: " + missing, "file error: missing input");
+    {
+        ofstream file(missing, ios::binary);
+        file << "text";
+    }
+    check(huffman.compressFile(missing, output) && huffman.lastError().empty(), "file error: cleared after success");
+    filesystem::remove(missing);
+    filesystem::remove(output);
+}
+
+// Returning false from the progress callback stops a job with Status::Cancelled
+void testCancel() {
+    const vector<uint8_t> input = makeCorpus("text");
+    HuffmanCoding huffman;
+    huffman.setBlockSize(16384);
+    huffman.setThreadCount(1);
+    vector<uint8_t> compressed, output;
+    huffman.compress(input.data(), input.size(), compressed);
+    huffman.setProgressCallback([](uint64_t done, uint64_t) { return done < 40000; });
+    check(huffman.compress(input.data(), input.size(), output) == HuffmanCoding::Status::Cancelled, "cancelled compress");
+    huffman.setProgressCallback([](uint64_t done, uint64_t) { return done < 20000; });
+    check(huffman.decompress(compressed.data(), compressed.size(), output) == HuffmanCoding::Status::Cancelled, "cancelled decompress");
+}
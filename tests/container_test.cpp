@@ -0,0 +1,45 @@
+#include "testing.h"
+#include "Crc32c.h"
+
+// The container: CRC32C values and frame headers that claim impossible sizes
+
+void testChecksums() {
+    check(crc32c(0, "123456789", 9) == 0xE3069283, "crc32c check value");
+    check(crc32c(crc32c(0, "1234", 4), "56789", 5) == 0xE3069283, "crc32c continuation");
+}
+
+// A stream header and one frame header with the given sizes, and payloadBytes zero bytes of payload
+static vector<uint8_t> craftFrame(uint8_t type, uint32_t rawSize, uint32_t payloadSize, size_t payloadBytes) {
+    vector<uint8_t> data = {'H', 'U', 'F', 'C', 1, type};
+    for (uint32_t value : {rawSize, payloadSize, 0u}) {
+        for (int i = 0; i < 4; ++i)
+            data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+    data.resize(data.size() + payloadBytes);
+    return data;
+}
+
+// Sizes claimed by frame headers are checked before anything is allocated for them
+void testCraftedHeaders() {
+    const uint8_t huffmanFrame = 1, adaptiveFrame = 3, storedFrame = 10, runFrame = 11;
+    const struct {
+        vector<uint8_t> data;
+        const char* what;
+    } crafted[] = {
+        {craftFrame(huffmanFrame, 100, 0xFFFFFFFF, 0), "huge payload"},
+        {craftFrame(adaptiveFrame, 1 << 30, 0xFFFFFFFF, 0), "huge adaptive payload"},
+        {craftFrame(storedFrame, 1 << 30, 0, 0), "stored frame without its bytes"},
+        {craftFrame(storedFrame, 1 << 30, 16, 16), "stored frame shorter than its raw size"},
+        {craftFrame(runFrame, 1 << 30, 2, 2), "run frame of two bytes"},
+        {craftFrame(huffmanFrame, 0xFFFFFFFF, 4, 4), "raw size over the block limit"},
+    };
+    for (const auto& frame : crafted) {
+        HuffmanCoding huffman;
+        vector<uint8_t> output;
+        check(huffman.decompress(frame.data.data(), frame.data.size(), output) == HuffmanCoding::Status::CorruptData,
+              string("crafted header accepted: ") + frame.what);
+        istringstream in(string(frame.data.begin(), frame.data.end()));
+        ostringstream out;
+        check(!huffman.decompressStream(in, out), string("crafted header streamed: ") + frame.what);
+    }
+}
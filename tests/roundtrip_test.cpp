@@ -0,0 +1,117 @@
+#include "testing.h"
+
+// Round trips of every mode (static, adaptive, context, 16-bit, words, LZ, BWT), with and without
+// interleaved streams, on one and several threads, through both decoders and the vector, fixed-size
+// buffer, stream and file APIs. Also compressBound, short output buffers, range reads, the seek
+// index, and bit flips and truncation of every layout.
+
+static string describe(const string& corpus, HuffmanCoding::Mode mode, bool interleaved, size_t blockSize, unsigned threads) {
+    ostringstream name;
+    name << corpus << " mode " << int(mode) << (interleaved ? " interleaved" : "") << " block " << blockSize << " threads " << threads;
+    return name.str();
+}
+
+// Flipped bits and truncation must never decode to wrong data with an Ok status
+static void checkCorruption(HuffmanCoding& huffman, const vector<uint8_t>& compressed, const vector<uint8_t>& input, const string& name, mt19937& rng) {
+    vector<uint8_t> output;
+    for (int trial = 0; trial < 24; ++trial) {
+        vector<uint8_t> corrupt = compressed;
+        corrupt[rng() % corrupt.size()] ^= static_cast<uint8_t>(1 << (rng() % 8));
+        if (huffman.decompress(corrupt.data(), corrupt.size(), output) == HuffmanCoding::Status::Ok)
+            check(output == input, name + ": bit flip decoded to wrong data");
+    }
+    // The index trailer is not needed to decode, so only cuts into the frames or the end record must fail
+    for (size_t cut = 0; cut + 8 < compressed.size(); cut += compressed.size() / 7 + 1) {
+        if (huffman.decompress(compressed.data(), cut, output) == HuffmanCoding::Status::Ok)
+            check(output == input, name + ": truncated stream decoded to wrong data");
+    }
+}
+
+void testRoundTrips() {
+    const HuffmanCoding::Mode modes[] = {HuffmanCoding::Mode::Static, HuffmanCoding::Mode::Adaptive, HuffmanCoding::Mode::Context, HuffmanCoding::Mode::Wide,
+                                         HuffmanCoding::Mode::Words, HuffmanCoding::Mode::Lz, HuffmanCoding::Mode::Bwt};
+    const HuffmanCoding::DecoderType decoders[] = {HuffmanCoding::DecoderType::Table, HuffmanCoding::DecoderType::TreeWalk};
+    const filesystem::path directory = filesystem::temp_directory_path();
+    const string inputFile = (directory / "huffman_test.in").string();
+    const string compressedFile = (directory / "huffman_test.huf").string();
+    const string outputFile = (directory / "huffman_test.out").string();
+    mt19937 rng(11);
+
+    for (const char* corpus : {"empty", "one-byte", "run", "random", "skewed", "text", "samples", "mixed"}) {
+        const vector<uint8_t> input = makeCorpus(corpus);
+        {
+            ofstream file(inputFile, ios::binary);
+            file.write(reinterpret_cast<const char*>(input.data()), input.size());
+        }
+        for (HuffmanCoding::Mode mode : modes) {
+            for (bool interleaved : {false, true}) {
+                for (size_t blockSize : {HuffmanCoding::DEFAULT_BLOCK_SIZE, size_t(16384)}) {
+                    const unsigned threads = blockSize == HuffmanCoding::DEFAULT_BLOCK_SIZE ? 1 : 3;
+                    const string name = describe(corpus, mode, interleaved, blockSize, threads);
+                    HuffmanCoding huffman;
+                    huffman.setMode(mode);
+                    huffman.setInterleaved(interleaved);
+                    huffman.setBlockSize(blockSize);
+                    huffman.setThreadCount(threads);
+
+                    // Buffer API, growing and fixed-size output
+                    vector<uint8_t> compressed, output;
+                    check(huffman.compress(input.data(), input.size(), compressed) == HuffmanCoding::Status::Ok, name + ": compress");
+                    check(compressed.size() <= huffman.compressBound(input.size()), name + ": compressBound exceeded");
+                    if (input.size() <= blockSize)
+                        check(compressed.size() < 4 || memcmp(compressed.data() + compressed.size() - 4, "HIDX", 4) != 0, name + ": index on a single block");
+                    vector<uint8_t> fixed(huffman.compressBound(input.size()));
+                    size_t written = 0;
+                    check(huffman.compress(input.data(), input.size(), fixed.data(), fixed.size(), written) == HuffmanCoding::Status::Ok
+                          && written == compressed.size(), name + ": fixed-size compress");
+                    for (HuffmanCoding::DecoderType decoder : decoders) {
+                        const string decoderName = name + (decoder == HuffmanCoding::DecoderType::Table ? " table" : " tree");
+                        check(huffman.decompress(compressed.data(), compressed.size(), output, decoder) == HuffmanCoding::Status::Ok && output == input,
+                              decoderName + ": decompress");
+                        vector<uint8_t> exact(input.size());
+                        check(huffman.decompress(compressed.data(), compressed.size(), exact.data(), exact.size(), written, decoder) == HuffmanCoding::Status::Ok
+                              && written == input.size() && exact == input, decoderName + ": fixed-size decompress");
+                        if (!input.empty()) {
+                            check(huffman.decompress(compressed.data(), compressed.size(), exact.data(), exact.size() - 1, written, decoder) == HuffmanCoding::Status::OutputTooSmall,
+                                  decoderName + ": short output buffer accepted");
+                        }
+                    }
+
+                    // Stream API
+                    istringstream streamIn(string(input.begin(), input.end()));
+                    ostringstream streamCompressed;
+                    check(huffman.compressStream(streamIn, streamCompressed), name + ": compressStream");
+                    istringstream streamCompressedIn(streamCompressed.str());
+                    ostringstream streamOut;
+                    check(huffman.decompressStream(streamCompressedIn, streamOut) && streamOut.str() == string(input.begin(), input.end()),
+                          name + ": stream round trip");
+
+                    // File API and range reads
+                    check(huffman.compressFile(inputFile, compressedFile), name + ": compressFile");
+                    for (HuffmanCoding::DecoderType decoder : decoders) {
+                        check(huffman.decompressFile(compressedFile, outputFile, decoder), name + ": decompressFile");
+                        ifstream file(outputFile, ios::binary);
+                        vector<uint8_t> fileOutput((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+                        check(fileOutput == input, name + ": file round trip");
+                    }
+                    if (mode != HuffmanCoding::Mode::Adaptive && input.size() > 100) {
+                        for (int range = 0; range < 3; ++range) {
+                            uint64_t offset = rng() % input.size();
+                            size_t length = rng() % (input.size() - offset) + 1;
+                            vector<uint8_t> bytes;
+                            check(huffman.decompressRange(compressedFile, offset, length, bytes)
+                                  && bytes == vector<uint8_t>(input.begin() + offset, input.begin() + offset + length), name + ": range read");
+                        }
+                    }
+
+                    if (blockSize != HuffmanCoding::DEFAULT_BLOCK_SIZE && !compressed.empty())
+                        checkCorruption(huffman, compressed, input, name, rng);
+                }
+            }
+        }
+    }
+    filesystem::remove(inputFile);
+    filesystem::remove(compressedFile);
+    filesystem::remove(outputFile);
+}
+
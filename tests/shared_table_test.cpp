@@ -0,0 +1,29 @@
+#include "testing.h"
+
+// Shared code tables: blocks coded with a trained table, decoding without it, saving and loading
+
+void testSharedTable() {
+    const vector<uint8_t> text = makeCorpus("text");
+    HuffmanCoding huffman;
+    huffman.setBlockSize(4096);
+    huffman.trainTable(text.data(), 20000);
+    for (const char* corpus : {"text", "random", "run", "empty"}) {
+        const vector<uint8_t> input = makeCorpus(corpus);
+        vector<uint8_t> compressed, output;
+        huffman.compress(input.data(), input.size(), compressed);
+        check(compressed.size() <= huffman.compressBound(input.size()), string("shared ") + corpus + ": compressBound exceeded");
+        check(huffman.decompress(compressed.data(), compressed.size(), output) == HuffmanCoding::Status::Ok && output == input, string("shared ") + corpus + ": round trip");
+    }
+    // Text frames refer to the table, a codec without it cannot decode them
+    vector<uint8_t> compressed, output;
+    huffman.compress(text.data(), text.size(), compressed);
+    HuffmanCoding untrained;
+    check(untrained.decompress(compressed.data(), compressed.size(), output) == HuffmanCoding::Status::CorruptData, "shared: decoded without the table");
+
+    // A table survives a save and load, and there is nothing to save before one is trained
+    const string tableFile = (filesystem::temp_directory_path() / "huffman_test.table").string();
+    check(!untrained.saveTable(tableFile), "shared: untrained table saved");
+    check(huffman.saveTable(tableFile) && untrained.loadTable(tableFile), "shared: save and load");
+    check(untrained.decompress(compressed.data(), compressed.size(), output) == HuffmanCoding::Status::Ok && output == text, "shared: decoded with the loaded table");
+    filesystem::remove(tableFile);
+}
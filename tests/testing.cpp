@@ -0,0 +1,70 @@
+#include "testing.h"
+
+static int failures = 0;
+
+void check(bool ok, const string& what) {
+    if (!ok) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+vector<uint8_t> makeCorpus(const string& name) {
+    mt19937 rng(7);
+    vector<uint8_t> data;
+    if (name == "empty") {
+        return data;
+    } else if (name == "one-byte") {
+        data.push_back(42);
+    } else if (name == "run") {
+        data.assign(70000, 'z');
+    } else if (name == "random") {
+        data.resize(100000);
+        for (uint8_t& byte : data)
+            byte = static_cast<uint8_t>(rng());
+    } else if (name == "skewed") {
+        geometric_distribution<int> symbol(0.3);
+        data.resize(120000);
+        for (uint8_t& byte : data)
+            byte = static_cast<uint8_t>(min(symbol(rng), 255));
+    } else if (name == "text") {
+        const char* words[] = {"the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog", ". ", "\n", "INFO ", "request=", "ms "};
+        while (data.size() < 150000) {
+            const char* word = words[rng() % 13];
+            data.insert(data.end(), word, word + strlen(word));
+            if (rng() % 8 == 0)
+                data.push_back(static_cast<uint8_t>('0' + rng() % 10));
+        }
+    } else if (name == "samples") {
+        // 16-bit little-endian readings of a slowly drifting sensor, odd length
+        int value = 20000;
+        while (data.size() < 90001) {
+            value += static_cast<int>(rng() % 33) - 16;
+            data.push_back(static_cast<uint8_t>(value));
+            data.push_back(static_cast<uint8_t>(value >> 8));
+        }
+        data.resize(90001);
+    } else if (name == "mixed") {
+        // Compressible and incompressible stretches, so blocks take different frame types
+        for (int stretch = 0; stretch < 12; ++stretch) {
+            for (int i = 0; i < 9000; ++i)
+                data.push_back(stretch % 2 ? static_cast<uint8_t>(rng()) : static_cast<uint8_t>('a' + rng() % 4));
+        }
+    }
+    return data;
+}
+
+int main() {
+    testRoundTrips();
+    testSharedTable();
+    testCraftedHeaders();
+    testChecksums();
+    testFileErrors();
+    testCancel();
+    if (failures != 0) {
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "All tests passed" << endl;
+    return 0;
+}
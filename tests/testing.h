@@ -0,0 +1,21 @@
+#ifndef TESTING_H
+#define TESTING_H
+#include "HuffmanCoding.h"
+#include <filesystem>
+#include <random>
+#include <sstream>
+
+// Helpers shared by the test files. Every test function records its failures through check,
+// and main runs them all and exits with 1 if any check failed.
+
+void check(bool ok, const string& what);
+// Generated input named empty, one-byte, run, random, skewed, text, samples or mixed
+vector<uint8_t> makeCorpus(const string& name);
+
+void testRoundTrips();
+void testSharedTable();
+void testCraftedHeaders();
+void testChecksums();
+void testFileErrors();
+void testCancel();
+#endif // TESTING_H
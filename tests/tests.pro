@@ -0,0 +1,16 @@
+# Tests of the codec, run by "make check"
+TEMPLATE = app
+TARGET = huffman_tests
+CONFIG += console c++17 testcase
+CONFIG -= qt app_bundle
+
+SOURCES += \
+    testing.cpp \
+    roundtrip_test.cpp \
+    shared_table_test.cpp \
+    container_test.cpp \
+    api_test.cpp
+
+HEADERS += testing.h
+
+include(../huffman.pri)